@@ -0,0 +1,212 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkCleaverBatchMesher_h
+#define itkCleaverBatchMesher_h
+
+#include "itkCleaverImageToMeshFilter.h"
+#include "itkObject.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class CleaverBatchMesher
+ *
+ * \brief Mesh a cohort of subjects with CleaverImageToMeshFilter.
+ *
+ * Each subject is a label image or a set of indicator function images. The
+ * subjects are meshed concurrently by NumberOfConcurrentSubjects workers that
+ * share the work units of the process. Each worker keeps one filter,
+ * configured like the Prototype, for all of the subjects it meshes. Subjects
+ * start in the order they were added, each once its estimated memory fits in
+ * the MemoryBudget next to the subjects in progress.
+ *
+ * Only the filter objects are reused across subjects. Scratch buffers,
+ * fields and Cleaver meshes are not: the images, indicator functions, sizing
+ * field and background mesh of a subject are allocated for it and released
+ * when it is done. Cleaver allocates its meshes and fields itself, so they
+ * cannot be drawn from a pool here.
+ *
+ * A subject that fails, for example with no zero crossing in an indicator
+ * function, records its error and the rest of the batch carries on.
+ *
+ * \ingroup Cleaver
+ */
+template <typename TInputImage, typename TOutputMesh>
+class CleaverBatchMesher : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(CleaverBatchMesher);
+
+  /** Standard class typedefs. */
+  using Self = CleaverBatchMesher;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Run-time type information. */
+  itkOverrideGetNameOfClassMacro(CleaverBatchMesher);
+
+  /** Standard New macro. */
+  itkNewMacro(Self);
+
+  using InputImageType = TInputImage;
+  using OutputMeshType = TOutputMesh;
+  using FilterType = CleaverImageToMeshFilter<InputImageType, OutputMeshType>;
+  using StageStatisticsContainer = typename FilterType::StageStatisticsContainer;
+  using SubjectIdentifier = SizeValueType;
+
+  /** Filter whose parameters every subject is meshed with. Its inputs, its
+   * SizingField and ExportSizingField are not used. A default filter is used
+   * when it is not set. */
+  itkSetObjectMacro(Prototype, FilterType);
+  itkGetModifiableObjectMacro(Prototype, FilterType);
+
+  /** Number of subjects meshed at the same time. Zero, the default, uses one
+   * subject per four threads of the global default, and at least one. */
+  itkSetMacro(NumberOfConcurrentSubjects, unsigned int);
+  itkGetConstMacro(NumberOfConcurrentSubjects, unsigned int);
+
+  /** Memory, in megabytes, the subjects in progress may use together
+   * according to EstimateSubjectMemory(). Zero, the default, sets no limit.
+   * A subject above the budget on its own is meshed alone. */
+  itkSetMacro(MemoryBudget, SizeValueType);
+  itkGetConstMacro(MemoryBudget, SizeValueType);
+
+  /** Number of labels EstimateSubjectMemory() assumes for a subject given by
+   * a label image, whose pixels it does not read. Two by default. */
+  itkSetClampMacro(ExpectedNumberOfLabels, unsigned int, 2, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(ExpectedNumberOfLabels, unsigned int);
+
+  /** Add a subject given by a label image, or by its first indicator
+   * function image, and return its identifier. Subjects should not share
+   * image objects, since the pipeline updates the requested region of the
+   * inputs of the concurrent filters. */
+  SubjectIdentifier
+  AddSubject(const InputImageType * image);
+
+  /** Add an indicator function image to a subject. */
+  void
+  AddSubjectInput(SubjectIdentifier subject, const InputImageType * image);
+
+  /** Remove the subjects and their results. */
+  void
+  ClearSubjects();
+
+  SizeValueType
+  GetNumberOfSubjects() const
+  {
+    return m_Subjects.size();
+  }
+
+  /** Coarse estimate, in bytes, of the memory taken by the indicator
+   * functions and the temporary images of a subject, with the number of work
+   * units Compute() gives each subject and the IndicatorFunctionMemoryBudget
+   * of the prototype. The meshes are not included. Only the output
+   * information of the inputs is updated, so the inputs may come from a
+   * pipeline that has not run yet. */
+  SizeValueType
+  EstimateSubjectMemory(SubjectIdentifier subject) const;
+
+  /** Mesh every subject. */
+  void
+  Compute();
+
+  /** Results of a subject after Compute(). */
+  bool
+  GetSubjectSucceeded(SubjectIdentifier subject) const;
+  const std::string &
+  GetSubjectError(SubjectIdentifier subject) const;
+  OutputMeshType *
+  GetTetrahedralMesh(SubjectIdentifier subject) const;
+  OutputMeshType *
+  GetTriangleMesh(SubjectIdentifier subject) const;
+  const StageStatisticsContainer &
+  GetSubjectStageStatistics(SubjectIdentifier subject) const;
+
+  /** Compact outputs of a subject, as returned by the filter for output
+   * index, when the prototype has GenerateCompactOutput on. Null otherwise. */
+  const typename FilterType::CompactPointsContainer *
+  GetCompactPoints(SubjectIdentifier subject, DataObjectPointerArraySizeType index) const;
+  const typename FilterType::CompactConnectivityContainer *
+  GetCompactConnectivity(SubjectIdentifier subject, DataObjectPointerArraySizeType index) const;
+  const typename FilterType::CompactLabelsContainer *
+  GetCompactLabels(SubjectIdentifier subject, DataObjectPointerArraySizeType index) const;
+
+  /** Number of subjects the last Compute() attempted to mesh and failed. */
+  SizeValueType
+  GetNumberOfFailedSubjects() const;
+
+protected:
+  CleaverBatchMesher() = default;
+  ~CleaverBatchMesher() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  struct Subject
+  {
+    std::vector<typename InputImageType::ConstPointer> Inputs;
+    bool                                               Attempted{ false };
+    bool                                               Succeeded{ false };
+    std::string                                        Error;
+    typename OutputMeshType::Pointer                   TetrahedralMesh;
+    typename OutputMeshType::Pointer                   TriangleMesh;
+    StageStatisticsContainer                           StageStatistics;
+    std::array<typename FilterType::CompactPointsContainer::ConstPointer, 2>       CompactPoints;
+    std::array<typename FilterType::CompactConnectivityContainer::ConstPointer, 2> CompactConnectivity;
+    std::array<typename FilterType::CompactLabelsContainer::ConstPointer, 2>       CompactLabels;
+  };
+
+  /** Number of subjects meshed at the same time by Compute(). */
+  unsigned int
+  GetNumberOfWorkers() const;
+
+  /** Number of work units of the filter of each worker. */
+  ThreadIdType
+  GetNumberOfWorkUnitsPerSubject() const;
+
+  /** New filter with the parameters of the prototype. */
+  typename FilterType::Pointer
+  MakeFilter(ThreadIdType numberOfWorkUnits) const;
+
+  /** Mesh a subject with the filter and record the outcome. Return false when
+   * the subject failed. */
+  bool
+  MeshSubject(FilterType * filter, Subject & subject) const;
+
+  const Subject &
+  GetSubject(SubjectIdentifier subject) const;
+
+  typename FilterType::Pointer m_Prototype;
+  std::vector<Subject>         m_Subjects;
+  unsigned int                 m_NumberOfConcurrentSubjects{ 0 };
+  SizeValueType                m_MemoryBudget{ 0 };
+  unsigned int                 m_ExpectedNumberOfLabels{ 2 };
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkCleaverBatchMesher.hxx"
+#endif
+
+#endif // itkCleaverBatchMesher_h
@@ -0,0 +1,415 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkCleaverBatchMesher_hxx
+#define itkCleaverBatchMesher_hxx
+
+#include "itkCleaverBatchMesher.h"
+
+#include "itkMultiThreaderBase.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace itk
+{
+
+template <typename TInputImage, typename TOutputMesh>
+auto
+CleaverBatchMesher<TInputImage, TOutputMesh>::AddSubject(const InputImageType * image) -> SubjectIdentifier
+{
+  if (image == nullptr)
+  {
+    itkExceptionMacro("A subject needs an input image.");
+  }
+  Subject subject;
+  subject.Inputs.emplace_back(image);
+  m_Subjects.push_back(std::move(subject));
+  this->Modified();
+  return m_Subjects.size() - 1;
+}
+
+template <typename TInputImage, typename TOutputMesh>
+void
+CleaverBatchMesher<TInputImage, TOutputMesh>::AddSubjectInput(SubjectIdentifier subject, const InputImageType * image)
+{
+  if (subject >= m_Subjects.size() || image == nullptr)
+  {
+    itkExceptionMacro("Cannot add an input to subject " << subject << " of " << m_Subjects.size() << '.');
+  }
+  m_Subjects[subject].Inputs.emplace_back(image);
+  this->Modified();
+}
+
+template <typename TInputImage, typename TOutputMesh>
+void
+CleaverBatchMesher<TInputImage, TOutputMesh>::ClearSubjects()
+{
+  m_Subjects.clear();
+  this->Modified();
+}
+
+template <typename TInputImage, typename TOutputMesh>
+SizeValueType
+CleaverBatchMesher<TInputImage, TOutputMesh>::EstimateSubjectMemory(SubjectIdentifier subject) const
+{
+  const Subject &              inputs = this->GetSubject(subject);
+  typename FilterType::Pointer prototype = m_Prototype ? m_Prototype : FilterType::New();
+
+  // The inputs may not have been updated yet; their pixels are not read.
+  const_cast<InputImageType *>(inputs.Inputs[0].GetPointer())->UpdateOutputInformation();
+  typename InputImageType::RegionType region = inputs.Inputs[0]->GetLargestPossibleRegion();
+  if (prototype->GetRegionOfInterest().GetNumberOfPixels() > 0)
+  {
+    region.Crop(prototype->GetRegionOfInterest());
+  }
+  const SizeValueType voxels = region.GetNumberOfPixels();
+
+  // One field per material. The labels of a label image are not counted.
+  SizeValueType materials = inputs.Inputs.size() == 1 ? 2 : inputs.Inputs.size();
+  if (inputs.Inputs.size() == 1 && !prototype->GetInputIsIndicatorFunction())
+  {
+    materials = m_ExpectedNumberOfLabels;
+  }
+
+  // Stored fields, the blurred and distance images of the labels in progress, the cast input and
+  // the sizing field.
+  const SizeValueType storedFields = prototype->GetUseSparseFields() ? 1 : materials;
+  // The labels in flight each hold the indicator and its blur, the padded copy, the distance map
+  // and its working image. The budget of the prototype bounds them, except a label above it, which
+  // is built alone.
+  const SizeValueType imageBytes = voxels * sizeof(float);
+  const SizeValueType labelTemporaries = 5 * imageBytes;
+  SizeValueType       temporaries =
+    labelTemporaries * std::min<SizeValueType>(materials, this->GetNumberOfWorkUnitsPerSubject());
+  const SizeValueType labelBudget = prototype->GetIndicatorFunctionMemoryBudget() * 1024 * 1024;
+  if (labelBudget > 0)
+  {
+    temporaries = std::max(labelTemporaries, std::min(temporaries, labelBudget));
+  }
+  return imageBytes * (storedFields + 2) + temporaries;
+}
+
+template <typename TInputImage, typename TOutputMesh>
+unsigned int
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetNumberOfWorkers() const
+{
+  unsigned int numberOfWorkers = m_NumberOfConcurrentSubjects;
+  if (numberOfWorkers == 0)
+  {
+    numberOfWorkers = std::max<unsigned int>(1, MultiThreaderBase::GetGlobalDefaultNumberOfThreads() / 4);
+  }
+  return static_cast<unsigned int>(
+    std::max<SizeValueType>(1, std::min<SizeValueType>(numberOfWorkers, m_Subjects.size())));
+}
+
+template <typename TInputImage, typename TOutputMesh>
+ThreadIdType
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetNumberOfWorkUnitsPerSubject() const
+{
+  return std::max<ThreadIdType>(1, MultiThreaderBase::GetGlobalDefaultNumberOfThreads() / this->GetNumberOfWorkers());
+}
+
+template <typename TInputImage, typename TOutputMesh>
+void
+CleaverBatchMesher<TInputImage, TOutputMesh>::Compute()
+{
+  const SizeValueType numberOfSubjects = m_Subjects.size();
+  if (numberOfSubjects == 0)
+  {
+    return;
+  }
+
+  for (auto & subject : m_Subjects)
+  {
+    subject.Attempted = false;
+  }
+
+  const unsigned int numberOfWorkers = this->GetNumberOfWorkers();
+  const ThreadIdType workUnitsPerSubject = this->GetNumberOfWorkUnitsPerSubject();
+
+  std::vector<SizeValueType> memory(numberOfSubjects, 0);
+  const SizeValueType        budget = m_MemoryBudget * 1024 * 1024;
+  if (budget > 0)
+  {
+    for (SizeValueType ii = 0; ii < numberOfSubjects; ii++)
+    {
+      memory[ii] = this->EstimateSubjectMemory(ii);
+    }
+  }
+
+  // Subjects start in order, each once its memory fits next to the subjects in progress. A subject
+  // taken by a worker waits for the subject before it to start.
+  std::mutex              mutex;
+  std::condition_variable released;
+  SizeValueType           nextSubject = 0;
+  SizeValueType           nextToStart = 0;
+  SizeValueType           memoryInUse = 0;
+  unsigned int            subjectsInProgress = 0;
+
+  const auto worker = [&]() {
+    typename FilterType::Pointer filter = this->MakeFilter(workUnitsPerSubject);
+    for (;;)
+    {
+      SizeValueType subject;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (nextSubject == numberOfSubjects)
+        {
+          return;
+        }
+        subject = nextSubject++;
+        released.wait(lock, [&] {
+          return nextToStart == subject &&
+                 (budget == 0 || subjectsInProgress == 0 || memoryInUse + memory[subject] <= budget);
+        });
+        memoryInUse += memory[subject];
+        ++subjectsInProgress;
+        ++nextToStart;
+      }
+      released.notify_all();
+
+      // A filter that failed, or had more inputs than the next subject, is replaced.
+      if (filter->GetNumberOfIndexedInputs() > m_Subjects[subject].Inputs.size())
+      {
+        filter = this->MakeFilter(workUnitsPerSubject);
+      }
+      if (!this->MeshSubject(filter, m_Subjects[subject]))
+      {
+        filter = this->MakeFilter(workUnitsPerSubject);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        memoryInUse -= memory[subject];
+        --subjectsInProgress;
+      }
+      released.notify_all();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int ii = 1; ii < numberOfWorkers; ii++)
+  {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto & thread : workers)
+  {
+    thread.join();
+  }
+  this->Modified();
+}
+
+template <typename TInputImage, typename TOutputMesh>
+auto
+CleaverBatchMesher<TInputImage, TOutputMesh>::MakeFilter(ThreadIdType numberOfWorkUnits) const ->
+  typename FilterType::Pointer
+{
+  auto filter = FilterType::New();
+  if (m_Prototype)
+  {
+    filter->SetInputIsIndicatorFunction(m_Prototype->GetInputIsIndicatorFunction());
+    filter->SetSigma(m_Prototype->GetSigma());
+    filter->SetSmoothing(m_Prototype->GetSmoothing());
+    filter->SetSamplingRate(m_Prototype->GetSamplingRate());
+    filter->SetLipschitz(m_Prototype->GetLipschitz());
+    filter->SetFeatureScaling(m_Prototype->GetFeatureScaling());
+    filter->SetPadding(m_Prototype->GetPadding());
+    filter->SetAlpha(m_Prototype->GetAlpha());
+    filter->SetRegionOfInterest(m_Prototype->GetRegionOfInterest());
+    filter->SetCropToForeground(m_Prototype->GetCropToForeground());
+    filter->SetUseSparseFields(m_Prototype->GetUseSparseFields());
+    filter->SetNarrowBandWidth(m_Prototype->GetNarrowBandWidth());
+    filter->SetIndicatorFunctionMemoryBudget(m_Prototype->GetIndicatorFunctionMemoryBudget());
+    filter->SetGenerateTetrahedralMesh(m_Prototype->GetGenerateTetrahedralMesh());
+    filter->SetGenerateTriangleMesh(m_Prototype->GetGenerateTriangleMesh());
+    filter->SetGenerateCompactOutput(m_Prototype->GetGenerateCompactOutput());
+  }
+  // Intermediates of one subject are never reused by the next.
+  filter->CacheIntermediatesOff();
+  filter->SetNumberOfWorkUnits(numberOfWorkUnits);
+  return filter;
+}
+
+template <typename TInputImage, typename TOutputMesh>
+bool
+CleaverBatchMesher<TInputImage, TOutputMesh>::MeshSubject(FilterType * filter, Subject & subject) const
+{
+  subject.Attempted = true;
+  subject.Succeeded = false;
+  subject.Error.clear();
+  subject.TetrahedralMesh = nullptr;
+  subject.TriangleMesh = nullptr;
+  subject.StageStatistics.clear();
+  subject.CompactPoints = {};
+  subject.CompactConnectivity = {};
+  subject.CompactLabels = {};
+  try
+  {
+    for (unsigned int ii = 0; ii < subject.Inputs.size(); ii++)
+    {
+      filter->SetInput(ii, subject.Inputs[ii]);
+    }
+    filter->Update();
+
+    // Keep the meshes; the filter makes new outputs for the next subject.
+    subject.TetrahedralMesh = filter->GetOutput(0);
+    subject.TetrahedralMesh->DisconnectPipeline();
+    subject.TriangleMesh = filter->GetOutput(1);
+    subject.TriangleMesh->DisconnectPipeline();
+    subject.StageStatistics = filter->GetStageStatistics();
+    // The filter makes new compact containers on each update, so these are not overwritten.
+    for (unsigned int ii = 0; ii < 2; ii++)
+    {
+      subject.CompactPoints[ii] = filter->GetCompactPoints(ii);
+      subject.CompactConnectivity[ii] = filter->GetCompactConnectivity(ii);
+      subject.CompactLabels[ii] = filter->GetCompactLabels(ii);
+    }
+    subject.Succeeded = true;
+  }
+  catch (const ExceptionObject & e)
+  {
+    subject.Error = e.GetDescription();
+  }
+  catch (const std::exception & e)
+  {
+    subject.Error = e.what();
+  }
+  return subject.Succeeded;
+}
+
+template <typename TInputImage, typename TOutputMesh>
+auto
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetSubject(SubjectIdentifier subject) const -> const Subject &
+{
+  if (subject >= m_Subjects.size())
+  {
+    itkExceptionMacro("Subject " << subject << " is out of range; there are " << m_Subjects.size() << " subjects.");
+  }
+  return m_Subjects[subject];
+}
+
+template <typename TInputImage, typename TOutputMesh>
+bool
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetSubjectSucceeded(SubjectIdentifier subject) const
+{
+  return this->GetSubject(subject).Succeeded;
+}
+
+template <typename TInputImage, typename TOutputMesh>
+const std::string &
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetSubjectError(SubjectIdentifier subject) const
+{
+  return this->GetSubject(subject).Error;
+}
+
+template <typename TInputImage, typename TOutputMesh>
+auto
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetTetrahedralMesh(SubjectIdentifier subject) const -> OutputMeshType *
+{
+  return this->GetSubject(subject).TetrahedralMesh.GetPointer();
+}
+
+template <typename TInputImage, typename TOutputMesh>
+auto
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetTriangleMesh(SubjectIdentifier subject) const -> OutputMeshType *
+{
+  return this->GetSubject(subject).TriangleMesh.GetPointer();
+}
+
+template <typename TInputImage, typename TOutputMesh>
+auto
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetSubjectStageStatistics(SubjectIdentifier subject) const
+  -> const StageStatisticsContainer &
+{
+  return this->GetSubject(subject).StageStatistics;
+}
+
+template <typename TInputImage, typename TOutputMesh>
+auto
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetCompactPoints(SubjectIdentifier              subject,
+                                                               DataObjectPointerArraySizeType index) const
+  -> const typename FilterType::CompactPointsContainer *
+{
+  const Subject & results = this->GetSubject(subject);
+  if (index >= results.CompactPoints.size())
+  {
+    itkExceptionMacro("Output " << index << " is out of range; there are " << results.CompactPoints.size()
+                                << " outputs.");
+  }
+  return results.CompactPoints[index].GetPointer();
+}
+
+template <typename TInputImage, typename TOutputMesh>
+auto
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetCompactConnectivity(SubjectIdentifier              subject,
+                                                                     DataObjectPointerArraySizeType index) const
+  -> const typename FilterType::CompactConnectivityContainer *
+{
+  const Subject & results = this->GetSubject(subject);
+  if (index >= results.CompactConnectivity.size())
+  {
+    itkExceptionMacro("Output " << index << " is out of range; there are " << results.CompactConnectivity.size()
+                                << " outputs.");
+  }
+  return results.CompactConnectivity[index].GetPointer();
+}
+
+template <typename TInputImage, typename TOutputMesh>
+auto
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetCompactLabels(SubjectIdentifier              subject,
+                                                               DataObjectPointerArraySizeType index) const
+  -> const typename FilterType::CompactLabelsContainer *
+{
+  const Subject & results = this->GetSubject(subject);
+  if (index >= results.CompactLabels.size())
+  {
+    itkExceptionMacro("Output " << index << " is out of range; there are " << results.CompactLabels.size()
+                                << " outputs.");
+  }
+  return results.CompactLabels[index].GetPointer();
+}
+
+template <typename TInputImage, typename TOutputMesh>
+SizeValueType
+CleaverBatchMesher<TInputImage, TOutputMesh>::GetNumberOfFailedSubjects() const
+{
+  return static_cast<SizeValueType>(std::count_if(
+    m_Subjects.begin(), m_Subjects.end(), [](const Subject & subject) { return subject.Attempted && !subject.Succeeded; }));
+}
+
+template <typename TInputImage, typename TOutputMesh>
+void
+CleaverBatchMesher<TInputImage, TOutputMesh>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  itkPrintSelfObjectMacro(Prototype);
+  os << indent << "NumberOfConcurrentSubjects: " << this->m_NumberOfConcurrentSubjects << std::endl;
+  os << indent << "MemoryBudget: " << this->m_MemoryBudget << std::endl;
+  os << indent << "ExpectedNumberOfLabels: " << this->m_ExpectedNumberOfLabels << std::endl;
+  os << indent << "NumberOfSubjects: " << this->m_Subjects.size() << std::endl;
+  os << indent << "NumberOfFailedSubjects: " << this->GetNumberOfFailedSubjects() << std::endl;
+}
+
+} // end namespace itk
+
+#endif // itkCleaverBatchMesher_hxx
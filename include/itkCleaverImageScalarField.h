@@ -0,0 +1,126 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkCleaverImageScalarField_h
+#define itkCleaverImageScalarField_h
+
+#include "itkImage.h"
+
+#include "cleaver/ScalarField.h"
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+
+namespace itk
+{
+
+/** \class CleaverImageScalarField
+ *
+ * \brief Cleaver float field that samples the pixel buffer of an ITK image.
+ *
+ * The field holds a reference to the image and hands its pixel container to
+ * cleaver::FloatField, so an indicator function reaches the mesher without a
+ * copy. The buffered region of the image must be its largest possible region.
+ *
+ * \ingroup Cleaver
+ */
+template <typename TImage>
+class CleaverImageScalarField : public cleaver::FloatField
+{
+public:
+  using ImageType = TImage;
+  using ImagePointer = typename ImageType::Pointer;
+
+  static_assert(std::is_same<typename ImageType::PixelType, float>::value,
+                "CleaverImageScalarField requires a float pixel type.");
+  static_assert(ImageType::ImageDimension == 3, "CleaverImageScalarField requires a 3D image.");
+
+  explicit CleaverImageScalarField(ImageType * image)
+    : cleaver::FloatField(image->GetBufferPointer(),
+                          static_cast<int>(image->GetBufferedRegion().GetSize()[0]),
+                          static_cast<int>(image->GetBufferedRegion().GetSize()[1]),
+                          static_cast<int>(image->GetBufferedRegion().GetSize()[2]))
+    , m_Image(image)
+  {
+    const auto spacing = image->GetSpacing();
+    this->setScale(cleaver::vec3(spacing[0], spacing[1], spacing[2]));
+  }
+
+  ~CleaverImageScalarField() override
+  {
+    // The pixel container belongs to the image.
+    this->setData(nullptr);
+  }
+
+  CleaverImageScalarField(const CleaverImageScalarField &) = delete;
+  CleaverImageScalarField &
+  operator=(const CleaverImageScalarField &) = delete;
+
+  const ImageType *
+  GetImage() const
+  {
+    return m_Image.GetPointer();
+  }
+
+  /** Scan the buffer once for NaN values and for a zero crossing, and record
+   * the outcome with setError(): "nan", "maxmin" or "none". When negate is
+   * true, the values are negated in the same pass. */
+  void
+  Validate(bool negate)
+  {
+    float * const       buffer = m_Image->GetBufferPointer();
+    const SizeValueType numberOfPixels = m_Image->GetBufferedRegion().GetNumberOfPixels();
+    if (numberOfPixels == 0)
+    {
+      this->setError("maxmin");
+      return;
+    }
+
+    bool  nan = false;
+    float min = buffer[0];
+    float max = buffer[0];
+    for (SizeValueType ii = 0; ii < numberOfPixels; ++ii)
+    {
+      const float value = buffer[ii];
+      nan |= (value != value);
+      min = std::min(min, value);
+      max = std::max(max, value);
+      buffer[ii] = negate ? -value : value;
+    }
+
+    if (nan)
+    {
+      this->setError("nan");
+    }
+    else if (min >= 0 || max <= 0)
+    {
+      this->setError("maxmin");
+    }
+    else
+    {
+      this->setError("none");
+    }
+  }
+
+private:
+  ImagePointer m_Image;
+};
+
+} // end namespace itk
+
+#endif // itkCleaverImageScalarField_h
@@ -19,10 +19,61 @@
 #define itkCleaverImageToMeshFilter_h
 
 #include "itkImageToMeshFilter.h"
+#include "itkImage.h"
+#include "itkTimeProbe.h"
+#include "itkVectorContainer.h"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cleaver
+{
+class AbstractScalarField;
+}
 
 namespace itk
 {
 
+/** \class CleaverImageToMeshFilterEnums
+ *
+ * \brief Contains the enum classes used by CleaverImageToMeshFilter.
+ *
+ * \ingroup Cleaver
+ */
+class CleaverImageToMeshFilterEnums
+{
+public:
+  /** \class Smoothing
+   * \ingroup Cleaver
+   * Gaussian used to blend the indicator functions. Discrete convolves with a
+   * truncated kernel whose width grows with sigma. Recursive applies an IIR
+   * approximation of the Gaussian whose cost does not depend on sigma. */
+  enum class Smoothing : uint8_t
+  {
+    Discrete = 0,
+    Recursive = 1
+  };
+};
+
+/** Print the Smoothing enum value. */
+inline std::ostream &
+operator<<(std::ostream & out, const CleaverImageToMeshFilterEnums::Smoothing value)
+{
+  return out << [value] {
+    switch (value)
+    {
+      case CleaverImageToMeshFilterEnums::Smoothing::Discrete:
+        return "itk::CleaverImageToMeshFilterEnums::Smoothing::Discrete";
+      case CleaverImageToMeshFilterEnums::Smoothing::Recursive:
+        return "itk::CleaverImageToMeshFilterEnums::Smoothing::Recursive";
+      default:
+        return "INVALID VALUE FOR itk::CleaverImageToMeshFilterEnums::Smoothing";
+    }
+  }();
+}
+
 /** \class CleaverImageToMeshFilter
  *
  * \brief Filters a image by iterating over its pixels.
@@ -45,6 +96,7 @@ public:
   using InputImageType = TInputImage;
   using OutputMeshType = TOutputMesh;
   using InputPixelType = typename InputImageType::PixelType;
+  using InputImageRegionType = typename InputImageType::RegionType;
   using OutputPixelType = typename OutputMeshType::PixelType;
 
   /** Standard class typedefs. */
@@ -55,6 +107,17 @@ public:
 
   using DataObjectPointerArraySizeType = typename Superclass::Superclass::DataObjectPointerArraySizeType;
 
+  using SmoothingEnum = CleaverImageToMeshFilterEnums::Smoothing;
+
+  /** Flat arrays of the compact output: interleaved point coordinates, the
+   * point ids of the cells and the material of each cell. */
+  using CompactPointsContainer = VectorContainer<IdentifierType, float>;
+  using CompactConnectivityContainer = VectorContainer<IdentifierType, uint32_t>;
+  using CompactLabelsContainer = VectorContainer<IdentifierType, int32_t>;
+
+  /** Image type of the Cleaver sizing field. */
+  using SizingFieldImageType = Image<float, InputImageDimension>;
+
   /** Run-time type information. */
   itkOverrideGetNameOfClassMacro(CleaverImageToMeshFilter);
 
@@ -72,6 +135,37 @@ public:
   itkSetMacro(Sigma, double);
   itkGetConstMacro(Sigma, double);
 
+  /** Gaussian used for the blending. Discrete, the default, matches earlier
+   * releases. Recursive keeps the cost of large sigmas on large volumes
+   * constant per voxel, at the price of small differences in the fields. */
+  itkSetEnumMacro(Smoothing, SmoothingEnum);
+  itkGetConstMacro(Smoothing, SmoothingEnum);
+
+  /** Store the indicator functions of a label image as block-sparse fields
+   * that keep their values within NarrowBandWidth voxels of the material
+   * interface only, and a clamped value elsewhere. Their memory then grows
+   * with the area of the interfaces instead of the number of labels times the
+   * number of voxels. The background label stays dense. Off by default. */
+  itkSetMacro(UseSparseFields, bool);
+  itkGetConstMacro(UseSparseFields, bool);
+  itkBooleanMacro(UseSparseFields);
+
+  /** Half width, in voxels, of the band of stored values of the sparse
+   * fields. Values farther from an interface are clamped, so the band should
+   * be wider than the background mesh edges that cross an interface. */
+  itkSetMacro(NarrowBandWidth, unsigned int);
+  itkGetConstMacro(NarrowBandWidth, unsigned int);
+
+  /** Memory, in megabytes, the temporary images of the labels of a label
+   * image may take together while their indicator functions are built
+   * concurrently, one label per work unit. A label starts once it fits next
+   * to the labels in progress. A label above the budget on its own is built
+   * alone, on all the work units. Zero, the default, allows half of the
+   * available physical memory, or as many labels as work units when it
+   * cannot be queried. */
+  itkSetMacro(IndicatorFunctionMemoryBudget, SizeValueType);
+  itkGetConstMacro(IndicatorFunctionMemoryBudget, SizeValueType);
+
   /** Sizing field sampling rate. The sampling rate of the input indicator functions or calculated indicator functions from segmentation files.
    * The default sample rate will be the dimensions of the volume. Smaller sampling creates coarser meshes.
    * Adjusting this parameter will also affect Cleaver’s runtime, with smaller values running faster. */
@@ -95,6 +189,161 @@ public:
   itkSetMacro(Alpha, double);
   itkGetConstMacro(Alpha, double);
 
+  /** Mesh only this region of the inputs. Only this region is requested from
+   * the upstream pipeline, so a streaming source reads no more than it. The
+   * default, an empty region, meshes their largest possible region. */
+  itkSetMacro(RegionOfInterest, InputImageRegionType);
+  itkGetConstReferenceMacro(RegionOfInterest, InputImageRegionType);
+
+  /** Mesh only the bounding box of the foreground, grown by Padding voxels and
+   * the support of the blending Gaussian. The foreground is every label above
+   * the lowest one of a label image; for indicator functions, it is where one
+   * of them exceeds the first, or where a single one is positive. Off by
+   * default. */
+  itkSetMacro(CropToForeground, bool);
+  itkGetConstMacro(CropToForeground, bool);
+  itkBooleanMacro(CropToForeground);
+
+  /** Region of the inputs meshed by the last update. Output point coordinates
+   * are those of the full inputs regardless of the cropping. */
+  itkGetConstReferenceMacro(MeshedRegion, InputImageRegionType);
+
+  /** Optional precomputed sizing field, for example the GetSizingFieldOutput()
+   * of an earlier run with the same meshed region. When set, SamplingRate, Lipschitz, FeatureScaling and
+   * Padding are not used. */
+  itkSetInputMacro(SizingField, SizingFieldImageType);
+  itkGetInputMacro(SizingField, SizingFieldImageType);
+
+  /** Copy the sizing field used for meshing to GetSizingFieldOutput(). Off by default. */
+  itkSetMacro(ExportSizingField, bool);
+  itkGetConstMacro(ExportSizingField, bool);
+  itkBooleanMacro(ExportSizingField);
+
+  /** Sizing field of the last update when ExportSizingField is on. */
+  itkGetModifiableObjectMacro(SizingFieldOutput, SizingFieldImageType);
+
+  /** Keep the indicator functions and the sizing field between updates. They
+   * are recomputed only when an input is modified or a parameter they depend
+   * on changes, so sweeping Alpha re-runs the cleaving stages only. Off by
+   * default: the intermediates are then released as soon as the mesher no
+   * longer needs them, before the output conversion. */
+  itkSetMacro(CacheIntermediates, bool);
+  itkGetConstMacro(CacheIntermediates, bool);
+  itkBooleanMacro(CacheIntermediates);
+
+  /** Release the cached indicator functions and sizing field. */
+  void
+  ReleaseCache();
+
+  /** Wall clock time and resident memory of a stage of the last GenerateData(). */
+  struct StageStatistics
+  {
+    std::string Name;
+    /** Wall clock time of the stage in seconds. */
+    double Time{ 0.0 };
+    /** Resident memory of the process at the end of the stage in kilobytes. */
+    SizeValueType Memory{ 0 };
+    /** Largest resident memory of the process, in kilobytes, from the start
+     * of the update to the end of this stage. See GetPeakMemoryIsHighWaterMark()
+     * for how it is measured. */
+    SizeValueType PeakMemory{ 0 };
+    /** Whether the stage reused the intermediates cached by an earlier update
+     * instead of computing them. */
+    bool Cached{ false };
+  };
+  using StageStatisticsContainer = std::vector<StageStatistics>;
+
+  /** Statistics of the stages of the last update, in execution order: indicator
+   * functions, sizing field, the Cleaver meshing stages and the output conversion. */
+  const StageStatisticsContainer &
+  GetStageStatistics() const
+  {
+    return m_StageStatistics;
+  }
+
+  /** Generate the tetrahedral mesh, output 0. On by default. */
+  itkSetMacro(GenerateTetrahedralMesh, bool);
+  itkGetConstMacro(GenerateTetrahedralMesh, bool);
+  itkBooleanMacro(GenerateTetrahedralMesh);
+
+  /** Generate the interface triangle mesh, output 1. On by default. */
+  itkSetMacro(GenerateTriangleMesh, bool);
+  itkGetConstMacro(GenerateTriangleMesh, bool);
+  itkBooleanMacro(GenerateTriangleMesh);
+
+  /** Write the generated meshes to flat arrays instead of the mesh outputs,
+   * which are then left empty. The arrays hold no per-cell objects and can be
+   * viewed as NumPy arrays or typed arrays without conversion. Off by
+   * default. */
+  itkSetMacro(GenerateCompactOutput, bool);
+  itkGetConstMacro(GenerateCompactOutput, bool);
+  itkBooleanMacro(GenerateCompactOutput);
+
+  /** Point coordinates, x y z for each point, of the compact form of output
+   * index. Null unless that mesh was generated with GenerateCompactOutput.
+   * Throws when index is not 0 or 1. */
+  const CompactPointsContainer *
+  GetCompactPoints(DataObjectPointerArraySizeType index) const
+  {
+    if (index >= m_CompactPoints.size())
+    {
+      itkExceptionMacro("Output " << index << " is out of range; there are " << m_CompactPoints.size()
+                                  << " outputs.");
+    }
+    return m_CompactPoints[index].GetPointer();
+  }
+
+  /** Point ids of the cells of the compact form of output index: four per
+   * tetrahedron or three per triangle. */
+  const CompactConnectivityContainer *
+  GetCompactConnectivity(DataObjectPointerArraySizeType index) const
+  {
+    if (index >= m_CompactConnectivity.size())
+    {
+      itkExceptionMacro("Output " << index << " is out of range; there are " << m_CompactConnectivity.size()
+                                  << " outputs.");
+    }
+    return m_CompactConnectivity[index].GetPointer();
+  }
+
+  /** Cell data of the compact form of output index, as in the mesh outputs. */
+  const CompactLabelsContainer *
+  GetCompactLabels(DataObjectPointerArraySizeType index) const
+  {
+    if (index >= m_CompactLabels.size())
+    {
+      itkExceptionMacro("Output " << index << " is out of range; there are " << m_CompactLabels.size()
+                                  << " outputs.");
+    }
+    return m_CompactLabels[index].GetPointer();
+  }
+
+  /** Resident memory of the process, in kilobytes, at the end of the last
+   * update, once the intermediates that are not cached were released. */
+  SizeValueType
+  GetCurrentMemoryUsage() const
+  {
+    return m_StageStatistics.empty() ? 0 : m_StageStatistics.back().Memory;
+  }
+
+  /** Largest resident memory of the process, in kilobytes, during the last
+   * update. Earlier updates do not contribute. */
+  SizeValueType
+  GetPeakMemoryUsage() const
+  {
+    return m_StageStatistics.empty() ? 0 : m_StageStatistics.back().PeakMemory;
+  }
+
+  /** Whether the peak memory of the last update is a true high-water mark.
+   * On Linux, the update resets the high-water mark of the process through
+   * /proc/self/clear_refs and reads VmHWM back at the end of each stage, so
+   * transient peaks within a stage are included. The mark is process wide:
+   * memory of other threads is included, and a filter that updates at the
+   * same time resets it too. Where the mark cannot be reset, the peak is the
+   * largest resident memory sampled at the stage ends, which misses the
+   * transient peaks within the stages. */
+  itkGetConstMacro(PeakMemoryIsHighWaterMark, bool);
+
   /** Get the outptu meshes. Output 0 is the tetrahedral mesh. Output 1 is the
    * interface triangle mesh. */
   OutputMeshType *
@@ -104,7 +353,7 @@ public:
 
 protected:
   CleaverImageToMeshFilter();
-  ~CleaverImageToMeshFilter() override = default;
+  ~CleaverImageToMeshFilter() override;
 
   void PrintSelf(std::ostream & os, Indent indent) const override;
 
@@ -112,7 +361,42 @@ protected:
 
   void GenerateData() override;
 
+  /** Throw ProcessAborted if AbortGenerateData is set. */
+  void
+  CheckAbort() const;
+
+  /** Record the statistics of the stage that just finished, advance the
+   * progress by the stage's weight and honor AbortGenerateData. Cached tells
+   * whether the stage reused cached intermediates. */
+  void
+  CompleteStage(const char * name, float weight, bool cached = false);
+
+  /** Request the region to mesh from every input through the usual pipeline
+   * mechanism instead of their largest possible region. */
+  void
+  GenerateInputRequestedRegion() override;
+
 private:
+  /** Largest possible region of the inputs cropped to the RegionOfInterest. */
+  InputImageRegionType
+  GetRegionToMesh() const;
+
+  /** Inputs and parameter values an intermediate result was computed from. */
+  struct CacheKey
+  {
+    std::vector<const DataObject *> Inputs;
+    std::vector<ModifiedTimeType>   InputTimes;
+    std::vector<double>             Parameters;
+
+    bool
+    operator==(const CacheKey & other) const
+    {
+      return Inputs == other.Inputs && InputTimes == other.InputTimes && Parameters == other.Parameters;
+    }
+  };
+
+  using ScalarFieldPointer = std::unique_ptr<cleaver::AbstractScalarField>;
+
   bool m_InputIsIndicatorFunction{false};
   double m_Alpha{0.4};
   double m_SamplingRate{1.0};
@@ -120,6 +404,34 @@ private:
   double m_FeatureScaling{1.0};
   int m_Padding{0};
   double m_Sigma{1.0};
+  SmoothingEnum m_Smoothing{ SmoothingEnum::Discrete };
+  bool          m_GenerateTetrahedralMesh{ true };
+  bool          m_GenerateTriangleMesh{ true };
+  bool          m_GenerateCompactOutput{ false };
+  bool          m_UseSparseFields{ false };
+  unsigned int  m_NarrowBandWidth{ 8 };
+  SizeValueType m_IndicatorFunctionMemoryBudget{ 0 };
+  bool   m_CropToForeground{ false };
+  bool   m_ExportSizingField{ false };
+  bool   m_CacheIntermediates{ false };
+  bool   m_PeakMemoryIsHighWaterMark{ false };
+
+  InputImageRegionType m_RegionOfInterest;
+  InputImageRegionType m_MeshedRegion;
+
+  std::vector<ScalarFieldPointer>       m_IndicatorFields;
+  CacheKey                              m_IndicatorFieldsKey;
+  ScalarFieldPointer                    m_SizingField;
+  CacheKey                              m_SizingFieldKey;
+  typename SizingFieldImageType::Pointer m_SizingFieldOutput;
+
+  std::array<typename CompactPointsContainer::Pointer, 2>       m_CompactPoints;
+  std::array<typename CompactConnectivityContainer::Pointer, 2> m_CompactConnectivity;
+  std::array<typename CompactLabelsContainer::Pointer, 2>       m_CompactLabels;
+
+  StageStatisticsContainer m_StageStatistics;
+  TimeProbe                m_StageTimeProbe;
+  float                    m_StageProgress{ 0.0f };
 };
 } // namespace itk
 
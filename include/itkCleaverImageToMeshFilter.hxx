@@ -19,17 +19,26 @@
 #define itkCleaverImageToMeshFilter_hxx
 
 #include "itkCleaverImageToMeshFilter.h"
+#include "itkCleaverImageScalarField.h"
+#include "itkCleaverSparseScalarField.h"
 
 #include "itkImageRegionIterator.h"
 #include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageAlgorithm.h"
 #include "itkImage.h"
 #include "itkMinimumMaximumImageCalculator.h"
 #include "itkThresholdImageFilter.h"
 #include "itkCastImageFilter.h"
+#include "itkExtractImageFilter.h"
 #include "itkDiscreteGaussianImageFilter.h"
+#include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include "itkGaussianOperator.h"
 #include "itkMultiplyImageFilter.h"
 #include "itkSubtractImageFilter.h"
 #include "itkApproximateSignedDistanceMapImageFilter.h"
+#include "itkMemoryUsageObserver.h"
+#include "itksys/SystemInformation.hxx"
 
 #include "itkTetrahedronCell.h"
 #include "itkTriangleCell.h"
@@ -39,15 +48,26 @@
 #include "cleaver/CleaverMesher.h"
 #include "cleaver/SizingFieldCreator.h"
 
+#include <algorithm>
 #include <sstream>
 #include <cmath>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
 
 namespace
 {
 
 template <typename TImage>
 bool
-checkImageSize(TImage * inputImg, double sigma)
+checkImageSize(const TImage * inputImg, double sigma)
 {
   auto                dims = inputImg->GetLargestPossibleRegion().GetSize();
   auto                spacing = inputImg->GetSpacing();
@@ -57,128 +77,568 @@ checkImageSize(TImage * inputImg, double sigma)
   return (sigma / imageSizeMin) >= 0.1;
 }
 
+// Whether a pixel holds the label. Integer pixels are compared exactly; thresholds pull an integer
+// label out of a floating point label image.
+template <typename TPixel>
+bool
+isLabelValue(TPixel value, size_t label)
+{
+  if constexpr (std::is_integral<TPixel>::value)
+  {
+    return static_cast<double>(value) == static_cast<double>(label);
+  }
+  else
+  {
+    const auto lower = static_cast<TPixel>(static_cast<double>(label) - 0.001);
+    const auto upper = static_cast<TPixel>(static_cast<double>(label) + 0.001);
+    return lower <= value && value <= upper;
+  }
+}
+
+// Scan the label image once and return the bounding region of every label present. Labels are
+// material indices, so a negative label throws.
 template <typename TImage>
-std::vector<cleaver::AbstractScalarField *>
-segmentationToIndicatorFunctions(const TImage * image, double sigma)
+std::map<size_t, typename TImage::RegionType>
+findLabelRegions(const TImage * image, itk::MultiThreaderBase * multiThreader)
 {
   using ImageType = TImage;
-  using FloatImageType = itk::Image<float, ImageType::ImageDimension>;
-  using CasterType = itk::CastImageFilter<ImageType, FloatImageType>;
+  using IndexType = typename ImageType::IndexType;
+  using RegionType = typename ImageType::RegionType;
+  constexpr unsigned int Dimension = ImageType::ImageDimension;
+  using ExtentMap = std::map<size_t, std::pair<IndexType, IndexType>>;
+
+  ExtentMap  extents;
+  std::mutex extentsMutex;
+  bool       negativeLabel = false;
+  IndexType  negativeLabelIndex;
+  double     negativeLabelValue = 0.0;
+
+  const RegionType largestRegion = image->GetLargestPossibleRegion();
+  multiThreader->ParallelizeImageRegion<Dimension>(
+    largestRegion,
+    [&](const RegionType & region) {
+      ExtentMap                                           threadExtents;
+      auto                                                current = threadExtents.end();
+      itk::ImageRegionConstIteratorWithIndex<ImageType> it(image, region);
+      for (; !it.IsAtEnd(); ++it)
+      {
+        const auto   value = it.Get();
+        const double rounded = std::round(static_cast<double>(value));
+        if (rounded < 0.0)
+        {
+          const std::lock_guard<std::mutex> lock(extentsMutex);
+          if (!negativeLabel)
+          {
+            negativeLabel = true;
+            negativeLabelIndex = it.GetIndex();
+            negativeLabelValue = static_cast<double>(value);
+          }
+          return;
+        }
+        if (!isLabelValue(value, static_cast<size_t>(rounded)))
+        {
+          continue;
+        }
+        const auto      label = static_cast<size_t>(rounded);
+        const IndexType index = it.GetIndex();
+        if (current == threadExtents.end() || current->first != label)
+        {
+          current = threadExtents.find(label);
+          if (current == threadExtents.end())
+          {
+            current = threadExtents.emplace(label, std::make_pair(index, index)).first;
+          }
+        }
+        for (unsigned int d = 0; d < Dimension; d++)
+        {
+          current->second.first[d] = std::min(current->second.first[d], index[d]);
+          current->second.second[d] = std::max(current->second.second[d], index[d]);
+        }
+      }
 
-  auto caster = CasterType::New();
-  caster->SetInput(image);
-  caster->Update();
+      const std::lock_guard<std::mutex> lock(extentsMutex);
+      for (const auto & threadExtent : threadExtents)
+      {
+        auto merged = extents.emplace(threadExtent).first;
+        for (unsigned int d = 0; d < Dimension; d++)
+        {
+          merged->second.first[d] = std::min(merged->second.first[d], threadExtent.second.first[d]);
+          merged->second.second[d] = std::max(merged->second.second[d], threadExtent.second.second[d]);
+        }
+      }
+    },
+    nullptr);
 
-  // determine the number of labels in the segmentations
-  using ImageCalculatorFilterType = itk::MinimumMaximumImageCalculator<FloatImageType>;
-  auto imageCalculatorFilter = ImageCalculatorFilterType::New();
-  imageCalculatorFilter->SetImage(caster->GetOutput());
-  imageCalculatorFilter->Compute();
-  auto                                        maxLabel = static_cast<size_t>(imageCalculatorFilter->GetMaximum());
-  auto                                        minLabel = static_cast<size_t>(imageCalculatorFilter->GetMinimum());
-  std::vector<cleaver::AbstractScalarField *> fields;
+  if (negativeLabel)
+  {
+    itkGenericExceptionMacro("Negative label " << negativeLabelValue << " at index " << negativeLabelIndex
+                                               << "; labels must be non-negative material indices.");
+  }
 
-  // extract images from each label for an indicator function
-  for (size_t i = minLabel, num = 0; i <= maxLabel; i++, num++)
-  {
-    // Pull out this label
-    using ThreshType = itk::ThresholdImageFilter<FloatImageType>;
-    auto thresh = ThreshType::New();
-    thresh->SetInput(caster->GetOutput());
-    thresh->SetOutsideValue(0);
-    thresh->ThresholdOutside(static_cast<double>(i) - 0.001, static_cast<double>(i) + 0.001);
-    thresh->Update();
-
-    // Change the values to be from 0 to 1.
-    using MultiplyImageFilterType = itk::MultiplyImageFilter<FloatImageType, FloatImageType, FloatImageType>;
-    auto multiplyImageFilter = MultiplyImageFilterType::New();
-    multiplyImageFilter->SetInput(thresh->GetOutput());
-    multiplyImageFilter->SetConstant(1. / static_cast<double>(i));
-    multiplyImageFilter->Update();
-
-    auto inputImg = multiplyImageFilter->GetOutput();
-    bool warning = checkImageSize(inputImg, sigma);
+  std::map<size_t, RegionType> regions;
+  for (const auto & extent : extents)
+  {
+    RegionType region;
+    region.SetIndex(extent.second.first);
+    for (unsigned int d = 0; d < Dimension; d++)
+    {
+      region.SetSize(d, static_cast<itk::SizeValueType>(extent.second.second[d] - extent.second.first[d] + 1));
+    }
+    regions.emplace(extent.first, region);
+  }
+  return regions;
+}
+
+// Radius of the kernel the DiscreteGaussianImageFilter will apply to the image.
+template <typename TImage, typename TBlur>
+typename TImage::SizeType
+gaussianKernelRadius(const TImage * image, const TBlur * blur)
+{
+  constexpr unsigned int Dimension = TImage::ImageDimension;
+  typename TImage::SizeType radius;
+  const auto                spacing = image->GetSpacing();
+  for (unsigned int d = 0; d < Dimension; d++)
+  {
+    itk::GaussianOperator<double, Dimension> oper;
+    oper.SetDirection(d);
+    double variance = blur->GetVariance()[d];
+    if (blur->GetUseImageSpacing())
+    {
+      variance /= spacing[d] * spacing[d];
+    }
+    oper.SetVariance(variance);
+    oper.SetMaximumError(blur->GetMaximumError()[d]);
+    oper.SetMaximumKernelWidth(blur->GetMaximumKernelWidth());
+    oper.CreateDirectional();
+    radius[d] = oper.GetRadius(d);
+  }
+  return radius;
+}
 
-    // Do some blurring.
-    using GaussianBlurType = itk::DiscreteGaussianImageFilter<FloatImageType, FloatImageType>;
+// Radius, in voxels, of the neighborhood a blur with the given smoothing reads around each voxel.
+// The recursive Gaussian has an infinite impulse response; it is cut where the Gaussian falls
+// below 1e-4 of its peak, about 4.3 sigma.
+template <typename TImage>
+typename TImage::SizeType
+blurRadius(const TImage * image, double sigma, itk::CleaverImageToMeshFilterEnums::Smoothing smoothing)
+{
+  if (smoothing == itk::CleaverImageToMeshFilterEnums::Smoothing::Recursive)
+  {
+    constexpr double          truncation = 4.3;
+    typename TImage::SizeType radius;
+    const auto                spacing = image->GetSpacing();
+    for (unsigned int d = 0; d < TImage::ImageDimension; d++)
+    {
+      radius[d] = static_cast<itk::SizeValueType>(std::ceil(truncation * sigma / spacing[d]));
+    }
+    return radius;
+  }
+
+  using GaussianBlurType = itk::DiscreteGaussianImageFilter<TImage, TImage>;
+  auto blur = GaussianBlurType::New();
+  blur->SetVariance(sigma * sigma);
+  return gaussianKernelRadius(image, blur.GetPointer());
+}
+
+// Blur the image with a Gaussian of standard deviation sigma in physical units. The discrete
+// Gaussian convolves with a kernel whose width grows with sigma; the recursive Gaussian runs a
+// fixed order IIR filter along each axis, so its cost per voxel does not depend on sigma.
+template <typename TFloatImage>
+typename TFloatImage::Pointer
+blurImage(const TFloatImage *                           image,
+          double                                        sigma,
+          itk::CleaverImageToMeshFilterEnums::Smoothing smoothing,
+          itk::ThreadIdType                             numberOfWorkUnits)
+{
+  typename TFloatImage::Pointer blurred;
+  if (smoothing == itk::CleaverImageToMeshFilterEnums::Smoothing::Recursive)
+  {
+    using GaussianBlurType = itk::SmoothingRecursiveGaussianImageFilter<TFloatImage, TFloatImage>;
     auto blur = GaussianBlurType::New();
-    blur->SetInput(multiplyImageFilter->GetOutput());
+    blur->SetInput(image);
+    blur->SetSigma(sigma);
+    blur->SetNumberOfWorkUnits(numberOfWorkUnits);
+    blur->Update();
+    blurred = blur->GetOutput();
+  }
+  else
+  {
+    using GaussianBlurType = itk::DiscreteGaussianImageFilter<TFloatImage, TFloatImage>;
+    auto blur = GaussianBlurType::New();
+    blur->SetInput(image);
     blur->SetVariance(sigma * sigma);
+    blur->SetNumberOfWorkUnits(numberOfWorkUnits);
     blur->Update();
+    blurred = blur->GetOutput();
+  }
+  blurred->DisconnectPipeline();
+  return blurred;
+}
 
-    // find the average value between
-    auto calc = ImageCalculatorFilterType::New();
-    calc->SetImage(blur->GetOutput());
-    calc->Compute();
-    float mx = calc->GetMaximum();
-    float mn = calc->GetMinimum();
-    auto  md = (mx + mn) / 2.f;
-
-    // create a distance map with that minimum value as the levelset
-    using DMapType = itk::ApproximateSignedDistanceMapImageFilter<FloatImageType, FloatImageType>;
-    auto dm = DMapType::New();
-    dm->SetInput(blur->GetOutput());
-    dm->SetInsideValue(md + 0.1f);
-    dm->SetOutsideValue(md - 0.1f);
-    dm->Update();
-
-    // Convert the image to a cleaver "abstract field".
-    auto    img = dm->GetOutput();
-    auto    region = img->GetLargestPossibleRegion();
-    auto    numPixel = region.GetNumberOfPixels();
-    float * data = new float[numPixel];
-    auto    x = region.GetSize()[0], y = region.GetSize()[1], z = region.GetSize()[2];
-    fields.push_back(new cleaver::FloatField(data, x, y, z));
-    std::string       name("SegmentationLabel");
-    std::stringstream ss;
-    ss << name << i;
-    fields[num]->setName(ss.str());
-    fields[num]->setWarning(warning);
-    itk::ImageRegionConstIterator<FloatImageType> imageIterator(img, region);
-    size_t                                        pixel = 0;
-    float                                         min = static_cast<float>(imageIterator.Get());
-    float                                         max = static_cast<float>(imageIterator.Get());
-    auto                                          spacing = img->GetSpacing();
-    std::string                                   error = "none";
-    while (!imageIterator.IsAtEnd())
-    {
-      // Get the value of the current pixel.
-      float val = static_cast<float>(imageIterator.Get());
-      ((cleaver::FloatField *)fields[num])->data()[pixel++] = -val;
-      ++imageIterator;
-
-      // Error checking
-      if (std::isnan(val) && error.compare("none") == 0)
+// Regions a label's indicator function is blurred on and stored on. Label 0 scales the background
+// to NaN, so its indicator covers the whole volume.
+template <typename TLabelImage>
+void
+labelFieldRegions(const TLabelImage *                           image,
+                  size_t                                        label,
+                  const typename TLabelImage::RegionType &      labelRegion,
+                  double                                        sigma,
+                  itk::CleaverImageToMeshFilterEnums::Smoothing smoothing,
+                  unsigned int                                  narrowBandWidth,
+                  typename TLabelImage::RegionType &            blurRegion,
+                  typename TLabelImage::RegionType &            fieldRegion)
+{
+  using FloatImageType = itk::Image<float, TLabelImage::ImageDimension>;
+
+  const auto scale = static_cast<float>(1. / static_cast<double>(label));
+  const auto largestRegion = image->GetLargestPossibleRegion();
+  blurRegion = largestRegion;
+  fieldRegion = largestRegion;
+  if (0.0f * scale == 0.0f)
+  {
+    auto radius = blurRadius(image, sigma, smoothing);
+    for (auto & r : radius)
+    {
+      ++r;
+    }
+    blurRegion = labelRegion;
+    blurRegion.PadByRadius(radius);
+    blurRegion.Crop(largestRegion);
+    if (narrowBandWidth > 0)
+    {
+      fieldRegion = blurRegion;
+      fieldRegion.PadByRadius(itk::CleaverSparseScalarField<FloatImageType>::GetBandMargin(narrowBandWidth));
+      fieldRegion.Crop(largestRegion);
+    }
+  }
+}
+
+// Coarse estimate, in bytes, of the temporary images of a label's indicator function: the indicator
+// and its blur on the blur region, and the padded copy, the distance map and its working image on
+// the field region.
+template <typename TLabelImage>
+itk::SizeValueType
+labelScratchMemory(const TLabelImage *                           image,
+                   size_t                                        label,
+                   const typename TLabelImage::RegionType &      labelRegion,
+                   double                                        sigma,
+                   itk::CleaverImageToMeshFilterEnums::Smoothing smoothing,
+                   unsigned int                                  narrowBandWidth)
+{
+  typename TLabelImage::RegionType blurRegion;
+  typename TLabelImage::RegionType fieldRegion;
+  labelFieldRegions(image, label, labelRegion, sigma, smoothing, narrowBandWidth, blurRegion, fieldRegion);
+  return sizeof(float) * (2 * blurRegion.GetNumberOfPixels() + 3 * fieldRegion.GetNumberOfPixels());
+}
+
+// Build the signed distance indicator function of a single label.
+//
+// The blurred indicator is zero, or negligible for the recursive Gaussian, farther than the blur
+// radius from the label's bounding box, so the threshold, scaling and blur only run on that
+// neighborhood. The result is pasted into a zero image of the full extent before the distance map,
+// which keeps the field identical to blurring the whole volume with the discrete Gaussian.
+//
+// With a narrow band width, the distance map only covers the neighborhood grown by the band, and
+// the field keeps its values near the zero crossing only.
+template <typename TLabelImage>
+std::unique_ptr<cleaver::AbstractScalarField>
+labelToIndicatorFunction(const TLabelImage *                           image,
+                         size_t                                        label,
+                         const typename TLabelImage::RegionType &      labelRegion,
+                         double                                        sigma,
+                         itk::CleaverImageToMeshFilterEnums::Smoothing smoothing,
+                         unsigned int                                  narrowBandWidth,
+                         bool                                          warning,
+                         itk::ThreadIdType                             numberOfWorkUnits)
+{
+  using LabelImageType = TLabelImage;
+  using FloatImageType = itk::Image<float, LabelImageType::ImageDimension>;
+  using RegionType = typename FloatImageType::RegionType;
+
+  // Change the values to be from 0 to 1.
+  const auto scale = static_cast<float>(1. / static_cast<double>(label));
+
+  const RegionType largestRegion = image->GetLargestPossibleRegion();
+  RegionType       blurRegion;
+  RegionType       fieldRegion;
+  labelFieldRegions(image, label, labelRegion, sigma, smoothing, narrowBandWidth, blurRegion, fieldRegion);
+
+  const bool sparse = narrowBandWidth > 0 && 0.0f * scale == 0.0f;
+
+  // Pull out this label
+  auto indicator = FloatImageType::New();
+  indicator->CopyInformation(image);
+  indicator->SetRegions(blurRegion);
+  indicator->Allocate();
+  itk::ImageRegionConstIterator<LabelImageType> inputIt(image, blurRegion);
+  itk::ImageRegionIterator<FloatImageType>      indicatorIt(indicator, blurRegion);
+  for (; !inputIt.IsAtEnd(); ++inputIt, ++indicatorIt)
+  {
+    const auto value = inputIt.Get();
+    indicatorIt.Set((isLabelValue(value, label) ? static_cast<float>(value) : 0.0f) * scale);
+  }
+
+  // Do some blurring.
+  typename FloatImageType::Pointer blurred = blurImage(indicator.GetPointer(), sigma, smoothing, numberOfWorkUnits);
+  indicator = nullptr;
+
+  // find the average value between
+  using ImageCalculatorFilterType = itk::MinimumMaximumImageCalculator<FloatImageType>;
+  auto calc = ImageCalculatorFilterType::New();
+  calc->SetImage(blurred);
+  calc->Compute();
+  float mx = calc->GetMaximum();
+  float mn = calc->GetMinimum();
+
+  if (blurRegion != largestRegion)
+  {
+    mx = std::max(mx, 0.0f);
+    mn = std::min(mn, 0.0f);
+  }
+  if (blurRegion != fieldRegion)
+  {
+    auto cropped = blurred;
+    blurred = FloatImageType::New();
+    blurred->CopyInformation(image);
+    blurred->SetRegions(fieldRegion);
+    blurred->Allocate();
+    blurred->FillBuffer(0.0f);
+    itk::ImageAlgorithm::Copy(cropped.GetPointer(), blurred.GetPointer(), blurRegion, blurRegion);
+  }
+  auto md = (mx + mn) / 2.f;
+
+  // create a distance map with that minimum value as the levelset
+  using DMapType = itk::ApproximateSignedDistanceMapImageFilter<FloatImageType, FloatImageType>;
+  auto dm = DMapType::New();
+  dm->SetInput(blurred);
+  dm->SetInsideValue(md + 0.1f);
+  dm->SetOutsideValue(md - 0.1f);
+  dm->SetNumberOfWorkUnits(numberOfWorkUnits);
+  dm->Update();
+
+  std::string       name("SegmentationLabel");
+  std::stringstream ss;
+  ss << name << label;
+  if (sparse)
+  {
+    auto field = std::make_unique<itk::CleaverSparseScalarField<FloatImageType>>(
+      dm->GetOutput(), largestRegion, narrowBandWidth, true);
+    field->setName(ss.str());
+    field->setWarning(warning);
+    return field;
+  }
+
+  // Hand the distance map buffer to cleaver as an "abstract field".
+  typename FloatImageType::Pointer img = dm->GetOutput();
+  img->DisconnectPipeline();
+  auto field = std::make_unique<itk::CleaverImageScalarField<FloatImageType>>(img);
+  field->setName(ss.str());
+  field->setWarning(warning);
+  field->Validate(true);
+  return field;
+}
+
+// Reset the resident memory high-water mark of the process, VmHWM, on Linux. Return whether it was
+// reset; it cannot be elsewhere, or on kernels without /proc/self/clear_refs.
+inline bool
+resetMemoryHighWaterMark()
+{
+#if defined(__linux__)
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5";
+  clearRefs.flush();
+  return static_cast<bool>(clearRefs);
+#else
+  return false;
+#endif
+}
+
+// Resident memory high-water mark of the process in kilobytes, or zero when it cannot be read.
+inline itk::SizeValueType
+memoryHighWaterMark()
+{
+#if defined(__linux__)
+  std::ifstream status("/proc/self/status");
+  std::string   line;
+  while (std::getline(status, line))
+  {
+    if (line.compare(0, 6, "VmHWM:") == 0)
+    {
+      return static_cast<itk::SizeValueType>(std::stoul(line.substr(6)));
+    }
+  }
+#endif
+  return 0;
+}
+
+// Default budget of the temporary images of the labels in flight: half of the available physical
+// memory, or no limit beyond the number of work units when it cannot be queried.
+inline itk::SizeValueType
+defaultIndicatorFunctionMemoryBudget()
+{
+  itksys::SystemInformation systemInformation;
+  systemInformation.QueryMemory();
+  const auto available = static_cast<itk::SizeValueType>(systemInformation.GetAvailablePhysicalMemory());
+  if (available == 0)
+  {
+    return std::numeric_limits<itk::SizeValueType>::max();
+  }
+  return available / 2 * 1024 * 1024;
+}
+
+// Build the indicator functions of the labels of a label image with integer or float pixels.
+//
+// The labels are built concurrently, one per work unit, each with single threaded filters. A label
+// starts only once its temporary images fit in memoryBudget bytes next to the labels in progress,
+// so the number of labels in flight follows their size as well as the number of work units. A
+// label above the budget on its own is built afterwards, alone, with the filters on all the work
+// units.
+template <typename TLabelImage>
+std::vector<std::unique_ptr<cleaver::AbstractScalarField>>
+labelImageToIndicatorFunctions(const TLabelImage *                           image,
+                               double                                        sigma,
+                               itk::CleaverImageToMeshFilterEnums::Smoothing smoothing,
+                               unsigned int                                  narrowBandWidth,
+                               itk::SizeValueType                            memoryBudget,
+                               const itk::ProcessObject *                    filter)
+{
+  itk::MultiThreaderBase * multiThreader = filter->GetMultiThreader();
+
+  // determine the labels in the segmentation
+  const auto                                     labelRegions = findLabelRegions(image, multiThreader);
+  std::vector<size_t>                            labels;
+  std::vector<typename TLabelImage::RegionType> regions;
+  for (const auto & labelRegion : labelRegions)
+  {
+    labels.push_back(labelRegion.first);
+    regions.push_back(labelRegion.second);
+  }
+
+  const bool warning = checkImageSize(image, sigma);
+
+  std::vector<itk::SizeValueType> memory(labels.size());
+  for (size_t ii = 0; ii < labels.size(); ii++)
+  {
+    memory[ii] = labelScratchMemory(image, labels[ii], regions[ii], sigma, smoothing, narrowBandWidth);
+  }
+  std::vector<size_t> concurrentLabels;
+  std::vector<size_t> largeLabels;
+  for (size_t ii = 0; ii < labels.size(); ii++)
+  {
+    (memory[ii] <= memoryBudget ? concurrentLabels : largeLabels).push_back(ii);
+  }
+
+  std::mutex              mutex;
+  std::condition_variable released;
+  itk::SizeValueType      memoryInUse = 0;
+
+  // extract images from each label for an indicator function
+  std::vector<std::unique_ptr<cleaver::AbstractScalarField>> fields(labels.size());
+  std::vector<std::exception_ptr>                            errors(labels.size());
+  multiThreader->ParallelizeArray(
+    0,
+    concurrentLabels.size(),
+    [&](itk::SizeValueType ii) {
+      const size_t num = concurrentLabels[ii];
+      if (filter->GetAbortGenerateData())
       {
-        error = "nan";
+        return;
       }
-      else if (val < min)
       {
-        min = val;
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [&] { return memory[num] <= memoryBudget - memoryInUse; });
+        memoryInUse += memory[num];
       }
-      else if (val > max)
+      try
       {
-        max = val;
+        fields[num] = labelToIndicatorFunction(
+          image, labels[num], regions[num], sigma, smoothing, narrowBandWidth, warning, 1);
       }
-    }
+      catch (...)
+      {
+        errors[num] = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        memoryInUse -= memory[num];
+      }
+      released.notify_all();
+    },
+    nullptr);
 
-    if ((min >= 0 || max <= 0) && (error.compare("none") == 0))
+  for (const size_t num : largeLabels)
+  {
+    if (filter->GetAbortGenerateData())
     {
-      error = "maxmin";
+      break;
     }
+    try
+    {
+      fields[num] = labelToIndicatorFunction(
+        image, labels[num], regions[num], sigma, smoothing, narrowBandWidth, warning, filter->GetNumberOfWorkUnits());
+    }
+    catch (...)
+    {
+      errors[num] = std::current_exception();
+    }
+  }
 
-    fields[num]->setError(error);
-    ((cleaver::FloatField *)fields[num])->setScale(cleaver::vec3(spacing[0], spacing[1], spacing[2]));
+  for (const auto & error : errors)
+  {
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+  }
+  if (filter->GetAbortGenerateData())
+  {
+    fields.clear();
   }
   return fields;
 }
 
+// Build one indicator function per label present in the image. The image is scanned once for the
+// labels and their bounding boxes, then the labels are processed concurrently on the work units of
+// the multi-threader. Integer label images are read as they are; other pixel types are cast to
+// float first.
 template <typename TImage>
-std::vector<cleaver::AbstractScalarField *>
-imagesToCleaverFloatFields(std::vector<const TImage *> images, double sigma)
+std::vector<std::unique_ptr<cleaver::AbstractScalarField>>
+segmentationToIndicatorFunctions(const TImage *                                image,
+                                 double                                        sigma,
+                                 itk::CleaverImageToMeshFilterEnums::Smoothing smoothing,
+                                 unsigned int                                  narrowBandWidth,
+                                 itk::SizeValueType                            memoryBudget,
+                                 const itk::ProcessObject *                    filter)
 {
-  std::vector<cleaver::AbstractScalarField *> fields;
-  size_t                                      num = 0;
+  using ImageType = TImage;
+  if constexpr (!std::is_integral<typename ImageType::PixelType>::value &&
+                !std::is_same<typename ImageType::PixelType, float>::value)
+  {
+    using FloatImageType = itk::Image<float, ImageType::ImageDimension>;
+    using CasterType = itk::CastImageFilter<ImageType, FloatImageType>;
+
+    auto caster = CasterType::New();
+    caster->SetInput(image);
+    caster->SetNumberOfWorkUnits(filter->GetNumberOfWorkUnits());
+    caster->Update();
+    return labelImageToIndicatorFunctions(
+      caster->GetOutput(), sigma, smoothing, narrowBandWidth, memoryBudget, filter);
+  }
+  else
+  {
+    return labelImageToIndicatorFunctions(image, sigma, smoothing, narrowBandWidth, memoryBudget, filter);
+  }
+}
+
+
+template <typename TImage>
+std::vector<std::unique_ptr<cleaver::AbstractScalarField>>
+imagesToCleaverFloatFields(std::vector<const TImage *>                  images,
+                           double                                        sigma,
+                           itk::CleaverImageToMeshFilterEnums::Smoothing smoothing,
+                           itk::ThreadIdType                             numberOfWorkUnits)
+{
+  std::vector<std::unique_ptr<cleaver::AbstractScalarField>> fields;
   for (auto image : images)
   {
     using ImageType = TImage;
@@ -187,6 +647,7 @@ imagesToCleaverFloatFields(std::vector<const TImage *> images, double sigma)
 
     auto caster = CasterType::New();
     caster->SetInput(image);
+    caster->SetNumberOfWorkUnits(numberOfWorkUnits);
     caster->Update();
 
     // Checking sigma vs the size of the image
@@ -194,59 +655,117 @@ imagesToCleaverFloatFields(std::vector<const TImage *> images, double sigma)
     bool warning = checkImageSize(inputImg, sigma);
 
     // do some blurring
-    using GaussianBlurType = itk::DiscreteGaussianImageFilter<FloatImageType, FloatImageType>;
-    auto blur = GaussianBlurType::New();
-    blur->SetInput(caster->GetOutput());
-    blur->SetVariance(sigma * sigma);
-    blur->Update();
-    auto img = blur->GetOutput();
-    // convert the image to a cleaver "abstract field"
-    auto    region = img->GetLargestPossibleRegion();
-    auto    numPixel = region.GetNumberOfPixels();
-    float * data = new float[numPixel];
-    auto    x = region.GetSize()[0], y = region.GetSize()[1], z = region.GetSize()[2];
-    fields.push_back(new cleaver::FloatField(data, x, y, z));
+    typename FloatImageType::Pointer img = blurImage(inputImg, sigma, smoothing, numberOfWorkUnits);
+    // hand the image buffer to cleaver as an "abstract field"
+    auto        field = std::make_unique<itk::CleaverImageScalarField<FloatImageType>>(img);
     std::string name("SegmentationLabel");
-    fields[num]->setName(name);
-    fields[num]->setWarning(warning);
-    itk::ImageRegionConstIterator<FloatImageType> imageIterator(img, region);
-    size_t                                        pixel = 0;
-    auto                                          spacing = img->GetSpacing();
-    float                                         min = static_cast<float>(imageIterator.Get());
-    float                                         max = static_cast<float>(imageIterator.Get());
-    std::string                                   error = "none";
-    while (!imageIterator.IsAtEnd())
-    {
-      // Get the value of the current pixel
-      float val = static_cast<float>(imageIterator.Get());
-      ((cleaver::FloatField *)fields[num])->data()[pixel++] = val;
-      ++imageIterator;
-
-      // Error checking
-      if (std::isnan(val) && error.compare("none") == 0)
+    field->setName(name);
+    field->setWarning(warning);
+    field->Validate(false);
+    fields.push_back(std::move(field));
+  }
+  return fields;
+}
+
+// Bounding region, within region, of the voxels where a material other than the background wins:
+// labels above the lowest one of a label image, or voxels where a later indicator function exceeds
+// the first one (where the indicator function is positive, for a single one). Empty when there are
+// no such voxels.
+template <typename TImage>
+typename TImage::RegionType
+foregroundRegion(const std::vector<const TImage *> & images,
+                 bool                                segmentation,
+                 const typename TImage::RegionType & region,
+                 itk::MultiThreaderBase *            multiThreader)
+{
+  using ImageType = TImage;
+  using PixelType = typename ImageType::PixelType;
+  using IndexType = typename ImageType::IndexType;
+  using RegionType = typename ImageType::RegionType;
+  constexpr unsigned int Dimension = ImageType::ImageDimension;
+
+  PixelType background{};
+  if (segmentation)
+  {
+    using ImageCalculatorFilterType = itk::MinimumMaximumImageCalculator<ImageType>;
+    auto calc = ImageCalculatorFilterType::New();
+    calc->SetImage(images[0]);
+    calc->SetRegion(region);
+    calc->ComputeMinimum();
+    background = calc->GetMinimum();
+  }
+
+  IndexType lower;
+  IndexType upper;
+  lower.Fill(itk::NumericTraits<itk::IndexValueType>::max());
+  upper.Fill(itk::NumericTraits<itk::IndexValueType>::NonpositiveMin());
+  bool       found = false;
+  std::mutex foundMutex;
+  multiThreader->ParallelizeImageRegion<Dimension>(
+    region,
+    [&](const RegionType & subregion) {
+      IndexType threadLower = lower;
+      IndexType threadUpper = upper;
+      bool      threadFound = false;
+
+      itk::ImageRegionConstIteratorWithIndex<ImageType>    it(images[0], subregion);
+      std::vector<itk::ImageRegionConstIterator<ImageType>> others;
+      for (size_t ii = 1; ii < images.size(); ii++)
       {
-        error = "nan";
+        others.emplace_back(images[ii], subregion);
       }
-      else if (val < min)
+      for (; !it.IsAtEnd(); ++it)
       {
-        min = val;
+        const PixelType value = it.Get();
+        bool            foreground = false;
+        if (segmentation)
+        {
+          foreground = value != background;
+        }
+        else if (others.empty())
+        {
+          foreground = value > 0;
+        }
+        for (auto & other : others)
+        {
+          foreground = foreground || other.Get() > value;
+          ++other;
+        }
+        if (foreground)
+        {
+          const IndexType index = it.GetIndex();
+          for (unsigned int d = 0; d < Dimension; d++)
+          {
+            threadLower[d] = std::min(threadLower[d], index[d]);
+            threadUpper[d] = std::max(threadUpper[d], index[d]);
+          }
+          threadFound = true;
+        }
       }
-      else if (val > max)
+
+      if (threadFound)
       {
-        max = val;
+        const std::lock_guard<std::mutex> lock(foundMutex);
+        for (unsigned int d = 0; d < Dimension; d++)
+        {
+          lower[d] = std::min(lower[d], threadLower[d]);
+          upper[d] = std::max(upper[d], threadUpper[d]);
+        }
+        found = true;
       }
-    }
+    },
+    nullptr);
 
-    if ((min >= 0 || max <= 0) && (error.compare("none") == 0))
+  RegionType foreground;
+  if (found)
+  {
+    foreground.SetIndex(lower);
+    for (unsigned int d = 0; d < Dimension; d++)
     {
-      error = "maxmin";
+      foreground.SetSize(d, static_cast<itk::SizeValueType>(upper[d] - lower[d] + 1));
     }
-
-    fields[num]->setError(error);
-    ((cleaver::FloatField *)fields[num])->setScale(cleaver::vec3(spacing[0], spacing[1], spacing[2]));
-    num++;
   }
-  return fields;
+  return foreground;
 }
 
 template <typename TImage>
@@ -263,26 +782,268 @@ cleaverFloatFieldToImage(const cleaver::FloatField * field, TImage * image)
   size[2] = static_cast<size_t>(dims[2]);
   typename ImageType::RegionType region(start, size);
   image->SetRegions(region);
+  const auto                      scale = field->scale();
+  const auto                      bounds = field->bounds();
+  typename ImageType::SpacingType spacing;
+  typename ImageType::PointType   origin;
+  for (unsigned int d = 0; d < 3; d++)
+  {
+    spacing[d] = scale[d];
+    origin[d] = bounds.origin[d];
+  }
+  image->SetSpacing(spacing);
+  image->SetOrigin(origin);
   image->Allocate();
-  image->FillBuffer(0);
-  auto data = ((cleaver::FloatField *)field)->data();
-  for (size_t i = 0; i < dims[0]; i++)
+  // Cleaver fields are stored x fastest, like ITK image buffers. Sparse fields have no buffer.
+  const float * data = ((cleaver::FloatField *)field)->data();
+  if (data == nullptr)
+  {
+    itkGenericExceptionMacro("The field has no dense buffer to export.");
+  }
+  std::transform(data, data + region.GetNumberOfPixels(), image->GetBufferPointer(), [](float value) {
+    return static_cast<typename ImageType::PixelType>(value);
+  });
+}
+
+// Assigns consecutive point ids to cleaver vertices in order of first use. Vertices are found by
+// identity; a vertex seen for the first time is merged with an earlier one that lies within the
+// tolerance in every coordinate, which is looked up through a spatial hash.
+class VertexIndexer
+{
+public:
+  VertexIndexer(const cleaver::TetMesh * mesh, double tolerance)
+    : m_Mesh(mesh)
+    , m_Tolerance(tolerance)
+    , m_Ids(mesh->verts.size(), Unassigned)
+  {}
+
+  size_t
+  GetId(cleaver::Vertex * vertex)
+  {
+    size_t & id = this->Slot(vertex);
+    if (id == Unassigned)
+    {
+      id = this->Merge(vertex->pos());
+    }
+    return id;
+  }
+
+  // Hand over the positions of the points, by id. No more ids can be assigned afterwards.
+  std::vector<cleaver::vec3>
+  TakePoints()
+  {
+    return std::move(m_Points);
+  }
+
+private:
+  static constexpr size_t Unassigned = std::numeric_limits<size_t>::max();
+
+  using CellKey = std::array<long long, 3>;
+  struct CellKeyHash
+  {
+    size_t
+    operator()(const CellKey & key) const
+    {
+      size_t hash = 0;
+      for (const auto k : key)
+      {
+        hash = hash * 0x9E3779B97F4A7C15ull + std::hash<long long>()(k);
+      }
+      return hash;
+    }
+  };
+
+  size_t &
+  Slot(cleaver::Vertex * vertex)
+  {
+    const auto index = vertex->tm_v_index;
+    if (index >= 0 && static_cast<size_t>(index) < m_Ids.size() && m_Mesh->verts[index] == vertex)
+    {
+      return m_Ids[index];
+    }
+    return m_OtherIds.emplace(vertex, Unassigned).first->second;
+  }
+
+  CellKey
+  Key(const cleaver::vec3 & position) const
   {
-    for (size_t j = 0; j < dims[1]; j++)
+    return { static_cast<long long>(std::floor(position.x / m_Tolerance)),
+             static_cast<long long>(std::floor(position.y / m_Tolerance)),
+             static_cast<long long>(std::floor(position.z / m_Tolerance)) };
+  }
+
+  size_t
+  Merge(const cleaver::vec3 & position)
+  {
+    const CellKey key = this->Key(position);
+    size_t        match = Unassigned;
+    for (long long dx = -1; dx <= 1; dx++)
     {
-      for (size_t k = 0; k < dims[2]; k++)
+      for (long long dy = -1; dy <= 1; dy++)
       {
-        typename ImageType::IndexType pixelIndex;
-        pixelIndex[0] = i;
-        pixelIndex[1] = j;
-        pixelIndex[2] = k;
-        image->SetPixel(pixelIndex,
-                        static_cast<typename ImageType::PixelType>(data[i + size[0] * j + size[0] * size[1] * k]));
+        for (long long dz = -1; dz <= 1; dz++)
+        {
+          const auto cell = m_Grid.find({ key[0] + dx, key[1] + dy, key[2] + dz });
+          if (cell == m_Grid.end())
+          {
+            continue;
+          }
+          for (const auto id : cell->second)
+          {
+            const cleaver::vec3 & point = m_Points[id];
+            if (id < match && std::abs(point.x - position.x) <= m_Tolerance &&
+                std::abs(point.y - position.y) <= m_Tolerance && std::abs(point.z - position.z) <= m_Tolerance)
+            {
+              match = id;
+            }
+          }
+        }
       }
     }
+    if (match != Unassigned)
+    {
+      return match;
+    }
+
+    const size_t id = m_Points.size();
+    m_Points.push_back(position);
+    m_Grid[key].push_back(id);
+    return id;
+  }
+
+  const cleaver::TetMesh *                                      m_Mesh;
+  const double                                                  m_Tolerance;
+  std::vector<size_t>                                           m_Ids;
+  std::unordered_map<const cleaver::Vertex *, size_t>           m_OtherIds;
+  std::vector<cleaver::vec3>                                    m_Points;
+  std::unordered_map<CellKey, std::vector<size_t>, CellKeyHash> m_Grid;
+};
+
+// Whether the STL container behind an itk::VectorContainer or itk::MapContainer is contiguous.
+template <typename TContainer, typename = void>
+struct HasContiguousStorage : std::false_type
+{};
+
+template <typename TContainer>
+struct HasContiguousStorage<TContainer,
+                            std::void_t<decltype(std::declval<typename TContainer::STLContainerType &>().data())>>
+  : std::true_type
+{};
+
+// Size the container and set element ii to element(ii), in parallel when the storage allows it.
+template <typename TContainer, typename TElementFunction>
+void
+fillContainer(TContainer * container, size_t size, TElementFunction element, itk::MultiThreaderBase * multiThreader)
+{
+  container->Reserve(size);
+  if constexpr (HasContiguousStorage<TContainer>::value)
+  {
+    auto & elements = container->CastToSTLContainer();
+    multiThreader->ParallelizeArray(
+      0, size, [&elements, &element](itk::SizeValueType ii) { elements[ii] = element(ii); }, nullptr);
+  }
+  else
+  {
+    for (size_t ii = 0; ii < size; ii++)
+    {
+      container->SetElement(ii, element(ii));
+    }
   }
 }
 
+// Replace the points, cells and cell data of the mesh. The points are translated by offset. Cells
+// have TCell's number of points and their point ids are read consecutively from pointIds.
+template <typename TCell, typename TMesh, typename TCellData>
+void
+fillMesh(TMesh *                                  mesh,
+         const std::vector<cleaver::vec3> &       points,
+         const cleaver::vec3 &                    offset,
+         const std::vector<itk::IdentifierType> & pointIds,
+         const std::vector<TCellData> &           cellData,
+         itk::MultiThreaderBase *                 multiThreader)
+{
+  using MeshType = TMesh;
+  using CellType = typename MeshType::CellType;
+  constexpr unsigned int NumberOfCellPoints = TCell::NumberOfPoints;
+
+  auto outputPoints = MeshType::PointsContainer::New();
+  fillContainer(
+    outputPoints.GetPointer(),
+    points.size(),
+    [&points, &offset](size_t ii) {
+      typename MeshType::PointType point;
+      point[0] = points[ii].x + offset.x;
+      point[1] = points[ii].y + offset.y;
+      point[2] = points[ii].z + offset.z;
+      return point;
+    },
+    multiThreader);
+
+  const size_t numberOfCells = cellData.size();
+  auto         outputCells = MeshType::CellsContainer::New();
+  fillContainer(
+    outputCells.GetPointer(),
+    numberOfCells,
+    [&pointIds](size_t ii) {
+      auto * cell = new TCell;
+      for (unsigned int jj = 0; jj < NumberOfCellPoints; jj++)
+      {
+        cell->SetPointId(jj, pointIds[ii * NumberOfCellPoints + jj]);
+      }
+      return static_cast<CellType *>(cell);
+    },
+    multiThreader);
+
+  using CellDataContainerType = typename MeshType::CellDataContainer;
+  auto outputCellData = CellDataContainerType::New();
+  fillContainer(
+    outputCellData.GetPointer(),
+    numberOfCells,
+    [&cellData](size_t ii) { return static_cast<typename CellDataContainerType::Element>(cellData[ii]); },
+    multiThreader);
+
+  mesh->SetPoints(outputPoints);
+  mesh->SetCellsAllocationMethod(itk::MeshEnums::MeshClassCellsAllocationMethod::CellsAllocatedDynamicallyCellByCell);
+  mesh->SetCells(outputCells);
+  mesh->SetCellData(outputCellData);
+}
+
+// Fill the flat arrays of a mesh: the interleaved coordinates of the points, translated by offset,
+// the point ids of the cells, read as they are from pointIds, and the cell data.
+template <typename TPoints, typename TConnectivity, typename TLabels, typename TCellData>
+void
+fillCompactMesh(TPoints *                                outputPoints,
+                TConnectivity *                          outputConnectivity,
+                TLabels *                                outputLabels,
+                const std::vector<cleaver::vec3> &       points,
+                const cleaver::vec3 &                    offset,
+                const std::vector<itk::IdentifierType> & pointIds,
+                const std::vector<TCellData> &           cellData,
+                itk::MultiThreaderBase *                 multiThreader)
+{
+  fillContainer(
+    outputPoints,
+    3 * points.size(),
+    [&points, &offset](size_t ii) {
+      const cleaver::vec3 & point = points[ii / 3];
+      const double          coordinate =
+        ii % 3 == 0 ? point.x + offset.x : (ii % 3 == 1 ? point.y + offset.y : point.z + offset.z);
+      return static_cast<typename TPoints::Element>(coordinate);
+    },
+    multiThreader);
+  fillContainer(
+    outputConnectivity,
+    pointIds.size(),
+    [&pointIds](size_t ii) { return static_cast<typename TConnectivity::Element>(pointIds[ii]); },
+    multiThreader);
+  fillContainer(
+    outputLabels,
+    cellData.size(),
+    [&cellData](size_t ii) { return static_cast<typename TLabels::Element>(cellData[ii]); },
+    multiThreader);
+}
+
+
 } // end anonymous namespace
 
 namespace itk
@@ -296,6 +1057,21 @@ CleaverImageToMeshFilter<TInputImage, TOutputMesh>::CleaverImageToMeshFilter()
 
   typename OutputMeshType::Pointer output = dynamic_cast<OutputMeshType *>(this->MakeOutput(1).GetPointer());
   this->ProcessObject::SetNthOutput(1, output.GetPointer());
+
+  this->AddOptionalInputName("SizingField");
+}
+
+template <typename TInputImage, typename TOutputMesh>
+CleaverImageToMeshFilter<TInputImage, TOutputMesh>::~CleaverImageToMeshFilter() = default;
+
+template <typename TInputImage, typename TOutputMesh>
+void
+CleaverImageToMeshFilter<TInputImage, TOutputMesh>::ReleaseCache()
+{
+  m_SizingField.reset();
+  m_SizingFieldKey = CacheKey();
+  m_IndicatorFields.clear();
+  m_IndicatorFieldsKey = CacheKey();
 }
 
 
@@ -320,6 +1096,20 @@ CleaverImageToMeshFilter<TInputImage, TOutputMesh>::PrintSelf(std::ostream & os,
   os << indent << "FeatureScaling: " << this->m_FeatureScaling << std::endl;
   os << indent << "Padding: " << this->m_Padding << std::endl;
   os << indent << "Alpha: " << this->m_Alpha << std::endl;
+  os << indent << "Smoothing: " << this->m_Smoothing << std::endl;
+  os << indent << "GenerateTetrahedralMesh: " << (this->m_GenerateTetrahedralMesh ? "On" : "Off") << std::endl;
+  os << indent << "GenerateTriangleMesh: " << (this->m_GenerateTriangleMesh ? "On" : "Off") << std::endl;
+  os << indent << "GenerateCompactOutput: " << (this->m_GenerateCompactOutput ? "On" : "Off") << std::endl;
+  os << indent << "UseSparseFields: " << (this->m_UseSparseFields ? "On" : "Off") << std::endl;
+  os << indent << "NarrowBandWidth: " << this->m_NarrowBandWidth << std::endl;
+  os << indent << "IndicatorFunctionMemoryBudget: " << this->m_IndicatorFunctionMemoryBudget << std::endl;
+  os << indent << "RegionOfInterest: " << this->m_RegionOfInterest << std::endl;
+  os << indent << "CropToForeground: " << (this->m_CropToForeground ? "On" : "Off") << std::endl;
+  os << indent << "MeshedRegion: " << this->m_MeshedRegion << std::endl;
+  os << indent << "ExportSizingField: " << (this->m_ExportSizingField ? "On" : "Off") << std::endl;
+  os << indent << "CacheIntermediates: " << (this->m_CacheIntermediates ? "On" : "Off") << std::endl;
+  os << indent << "PeakMemoryIsHighWaterMark: " << (this->m_PeakMemoryIsHighWaterMark ? "On" : "Off") << std::endl;
+  itkPrintSelfObjectMacro(SizingFieldOutput);
 }
 
 
@@ -338,33 +1128,208 @@ CleaverImageToMeshFilter<TInputImage, TOutputMesh>::GetOutput(DataObjectPointerA
   return static_cast<const OutputMeshType *>(this->ProcessObject::GetOutput(index));
 }
 
+template <typename TInputImage, typename TOutputMesh>
+auto
+CleaverImageToMeshFilter<TInputImage, TOutputMesh>::GetRegionToMesh() const -> InputImageRegionType
+{
+  const InputImageRegionType largestRegion = this->GetInput(0)->GetLargestPossibleRegion();
+  InputImageRegionType       region = largestRegion;
+  if (m_RegionOfInterest.GetNumberOfPixels() > 0 && !region.Crop(m_RegionOfInterest))
+  {
+    itkExceptionMacro("RegionOfInterest " << m_RegionOfInterest << " does not overlap the input region "
+                                          << largestRegion);
+  }
+  return region;
+}
+
+template <typename TInputImage, typename TOutputMesh>
+void
+CleaverImageToMeshFilter<TInputImage, TOutputMesh>::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  if (this->GetInput(0) == nullptr)
+  {
+    return;
+  }
+
+  const InputImageRegionType regionToMesh = this->GetRegionToMesh();
+  for (unsigned int ii = 0; ii < this->GetNumberOfIndexedInputs(); ii++)
+  {
+    auto * input = const_cast<InputImageType *>(this->GetInput(ii));
+    if (input)
+    {
+      input->SetRequestedRegion(regionToMesh);
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputMesh>
+void
+CleaverImageToMeshFilter<TInputImage, TOutputMesh>::CheckAbort() const
+{
+  if (this->GetAbortGenerateData())
+  {
+    ProcessAborted e(__FILE__, __LINE__);
+    e.SetDescription("Process aborted.");
+    e.SetLocation(ITK_LOCATION);
+    throw e;
+  }
+}
+
+template <typename TInputImage, typename TOutputMesh>
+void
+CleaverImageToMeshFilter<TInputImage, TOutputMesh>::CompleteStage(const char * name, float weight, bool cached)
+{
+  m_StageTimeProbe.Stop();
+
+  StageStatistics stage;
+  stage.Name = name;
+  stage.Time = m_StageTimeProbe.GetTotal();
+  MemoryUsageObserver memoryUsage;
+  stage.Memory = static_cast<SizeValueType>(memoryUsage.GetMemoryUsage());
+  SizeValueType peakMemory = stage.Memory;
+  if (m_PeakMemoryIsHighWaterMark)
+  {
+    peakMemory = std::max(peakMemory, memoryHighWaterMark());
+  }
+  stage.PeakMemory =
+    m_StageStatistics.empty() ? peakMemory : std::max(m_StageStatistics.back().PeakMemory, peakMemory);
+  stage.Cached = cached;
+  m_StageStatistics.push_back(stage);
+
+  m_StageProgress = std::min(m_StageProgress + weight, 1.0f);
+  this->UpdateProgress(m_StageProgress);
+  this->CheckAbort();
+
+  m_StageTimeProbe.Reset();
+  m_StageTimeProbe.Start();
+}
+
 template <typename TInputImage, typename TOutputMesh>
 void
 CleaverImageToMeshFilter<TInputImage, TOutputMesh>::GenerateData()
 {
-  std::vector<cleaver::AbstractScalarField *> fields;
+  m_StageStatistics.clear();
+  m_PeakMemoryIsHighWaterMark = resetMemoryHighWaterMark();
+  m_StageProgress = 0.0f;
+  this->UpdateProgress(0.0f);
+  m_StageTimeProbe.Reset();
+  m_StageTimeProbe.Start();
+
+  this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
 
   const bool segmentation = this->GetNumberOfIndexedInputs() < 2 && !this->GetInputIsIndicatorFunction();
 
-  if (segmentation)
+  CacheKey indicatorFieldsKey;
+  for (unsigned int ii = 0; ii < this->GetNumberOfIndexedInputs(); ii++)
   {
-    const InputImageType * input = this->GetInput();
-    fields = segmentationToIndicatorFunctions(input, m_Sigma);
+    const InputImageType * input = this->GetInput(ii);
+    indicatorFieldsKey.Inputs.push_back(input);
+    indicatorFieldsKey.InputTimes.push_back(input->GetMTime());
   }
-  else
+  indicatorFieldsKey.Parameters = { static_cast<double>(segmentation),
+                                    m_Sigma,
+                                    static_cast<double>(m_Smoothing),
+                                    static_cast<double>(m_UseSparseFields ? m_NarrowBandWidth : 0),
+                                    static_cast<double>(m_CropToForeground) };
+  for (unsigned int d = 0; d < InputImageDimension; d++)
+  {
+    indicatorFieldsKey.Parameters.push_back(static_cast<double>(m_RegionOfInterest.GetIndex(d)));
+    indicatorFieldsKey.Parameters.push_back(static_cast<double>(m_RegionOfInterest.GetSize(d)));
+  }
+  if (m_CropToForeground)
   {
+    indicatorFieldsKey.Parameters.push_back(static_cast<double>(m_Padding));
+  }
+
+  const bool computeIndicatorFields =
+    !m_CacheIntermediates || m_IndicatorFields.empty() || !(indicatorFieldsKey == m_IndicatorFieldsKey);
+  if (computeIndicatorFields)
+  {
+    this->ReleaseCache();
+
     std::vector<const InputImageType *> inputImages;
     for (unsigned int ii = 0; ii < this->GetNumberOfIndexedInputs(); ii++)
     {
       inputImages.push_back(this->GetInput(ii));
     }
-    fields = imagesToCleaverFloatFields(inputImages, m_Sigma);
 
-    if (this->GetNumberOfIndexedInputs() == 1)
+    // Region of the inputs to mesh.
+    const InputImageRegionType largestRegion = inputImages[0]->GetLargestPossibleRegion();
+    InputImageRegionType       meshedRegion = this->GetRegionToMesh();
+    if (m_CropToForeground)
+    {
+      InputImageRegionType foreground =
+        foregroundRegion(inputImages, segmentation, meshedRegion, this->GetMultiThreader());
+      if (foreground.GetNumberOfPixels() > 0)
+      {
+        auto margin = blurRadius(inputImages[0], m_Sigma, m_Smoothing);
+        for (auto & m : margin)
+        {
+          m += static_cast<SizeValueType>(std::max(m_Padding, 0)) + 1;
+        }
+        foreground.PadByRadius(margin);
+        foreground.Crop(meshedRegion);
+        meshedRegion = foreground;
+      }
+    }
+    m_MeshedRegion = meshedRegion;
+
+    std::vector<typename InputImageType::ConstPointer> croppedImages;
+    if (meshedRegion != largestRegion)
     {
-      fields.push_back(new cleaver::InverseScalarField(fields[0]));
-      fields.back()->setName(fields[0]->name() + "-inverse");
+      for (auto & inputImage : inputImages)
+      {
+        using ExtractFilterType = ExtractImageFilter<InputImageType, InputImageType>;
+        auto extract = ExtractFilterType::New();
+        extract->SetInput(inputImage);
+        extract->SetExtractionRegion(meshedRegion);
+        extract->SetDirectionCollapseToSubmatrix();
+        extract->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+        extract->Update();
+        typename InputImageType::Pointer croppedImage = extract->GetOutput();
+        croppedImage->DisconnectPipeline();
+        croppedImages.push_back(croppedImage.GetPointer());
+        inputImage = croppedImage.GetPointer();
+      }
+    }
+
+    std::vector<ScalarFieldPointer> fields;
+    if (segmentation)
+    {
+      SizeValueType memoryBudget = m_IndicatorFunctionMemoryBudget * 1024 * 1024;
+      if (memoryBudget == 0)
+      {
+        memoryBudget = defaultIndicatorFunctionMemoryBudget();
+      }
+      fields = segmentationToIndicatorFunctions(
+        inputImages[0], m_Sigma, m_Smoothing, m_UseSparseFields ? m_NarrowBandWidth : 0, memoryBudget, this);
+    }
+    else
+    {
+      fields = imagesToCleaverFloatFields(inputImages, m_Sigma, m_Smoothing, this->GetNumberOfWorkUnits());
+
+      if (inputImages.size() == 1)
+      {
+        fields.push_back(std::make_unique<cleaver::InverseScalarField>(fields[0].get()));
+        fields.back()->setName(fields[0]->name() + "-inverse");
+      }
     }
+
+    m_IndicatorFields = std::move(fields);
+    m_IndicatorFieldsKey = indicatorFieldsKey;
+  }
+
+  this->CheckAbort();
+  if (m_IndicatorFields.empty())
+  {
+    itkExceptionMacro("No labels found in the input image.");
+  }
+
+  std::vector<cleaver::AbstractScalarField *> fields;
+  for (const auto & field : m_IndicatorFields)
+  {
+    fields.push_back(field.get());
   }
 
   // Error checking for indicator function values.
@@ -380,6 +1345,8 @@ CleaverImageToMeshFilter<TInputImage, TOutputMesh>::GenerateData()
     auto error = ((cleaver::ScalarField<float> *)fields[i])->getError();
     if (error.compare("nan") == 0 || error.compare("maxmin") == 0)
     {
+      // Invalid fields are not worth keeping for the next update.
+      this->ReleaseCache();
       itkExceptionMacro("No zero crossing in indicator function. Not a valid file or need a lower sigma value.");
     }
     // Check for warning
@@ -389,44 +1356,108 @@ CleaverImageToMeshFilter<TInputImage, TOutputMesh>::GenerateData()
       itkWarningMacro("Nrrd file read WARNING: Sigma is 10% of volume's size. Gaussian kernel may be truncated.");
     }
   }
+  this->CompleteStage("IndicatorFunctions", 0.15f, !computeIndicatorFields);
 
   std::unique_ptr<cleaver::Volume> volume(new cleaver::Volume(fields));
 
   // Simple interface approximation
-  const bool             simple = false;
-  cleaver::CleaverMesher mesher(simple);
-  mesher.setVolume(volume.get());
-  mesher.setAlphaInit(m_Alpha);
+  const bool                              simple = false;
+  std::unique_ptr<cleaver::CleaverMesher> mesher(new cleaver::CleaverMesher(simple));
+  mesher->setVolume(volume.get());
+  mesher->setAlphaInit(m_Alpha);
 
   // Other option: cleaver::Constant
   const cleaver::MeshType elementSizingElement = cleaver::Adaptive;
   const bool              verbose = false;
 
-  std::vector<cleaver::AbstractScalarField *> sizingField;
-  sizingField.push_back(
-    cleaver::SizingFieldCreator::createSizingFieldFromVolume(volume.get(),
-                                                             (float)(1.0 / this->m_Lipschitz),
-                                                             (float)this->m_SamplingRate,
-                                                             (float)this->m_FeatureScaling,
-                                                             (int)this->m_Padding,
-                                                             (elementSizingElement != cleaver::Constant),
-                                                             verbose));
+  CacheKey                     sizingFieldKey = m_IndicatorFieldsKey;
+  const SizingFieldImageType * sizingFieldInput = this->GetSizingField();
+  if (sizingFieldInput)
+  {
+    sizingFieldKey.Inputs.push_back(sizingFieldInput);
+    sizingFieldKey.InputTimes.push_back(sizingFieldInput->GetMTime());
+  }
+  else
+  {
+    sizingFieldKey.Parameters.insert(sizingFieldKey.Parameters.end(),
+                                     { m_SamplingRate, m_Lipschitz, m_FeatureScaling, static_cast<double>(m_Padding) });
+  }
+
+  const bool computeSizingField = !m_CacheIntermediates || !m_SizingField || !(sizingFieldKey == m_SizingFieldKey);
+  if (computeSizingField)
+  {
+    m_SizingField.reset();
+    if (sizingFieldInput)
+    {
+      // Cleaver only reads the sizing field.
+      auto sizingField = std::make_unique<CleaverImageScalarField<SizingFieldImageType>>(
+        const_cast<SizingFieldImageType *>(sizingFieldInput));
+      const auto    origin = sizingFieldInput->GetOrigin();
+      const auto    spacing = sizingFieldInput->GetSpacing();
+      const auto    size = sizingFieldInput->GetBufferedRegion().GetSize();
+      cleaver::vec3 boundsOrigin(origin[0], origin[1], origin[2]);
+      cleaver::vec3 boundsSize(size[0] * spacing[0], size[1] * spacing[1], size[2] * spacing[2]);
+      sizingField->setBounds(cleaver::BoundingBox(boundsOrigin, boundsSize));
+      m_SizingField = std::move(sizingField);
+    }
+    else
+    {
+      m_SizingField.reset(
+        cleaver::SizingFieldCreator::createSizingFieldFromVolume(volume.get(),
+                                                                 (float)(1.0 / this->m_Lipschitz),
+                                                                 (float)this->m_SamplingRate,
+                                                                 (float)this->m_FeatureScaling,
+                                                                 (int)this->m_Padding,
+                                                                 (elementSizingElement != cleaver::Constant),
+                                                                 verbose));
+    }
+    m_SizingFieldKey = sizingFieldKey;
+  }
+
+  if (m_ExportSizingField)
+  {
+    if (computeSizingField || !m_SizingFieldOutput)
+    {
+      m_SizingFieldOutput = SizingFieldImageType::New();
+      cleaverFloatFieldToImage(static_cast<const cleaver::FloatField *>(m_SizingField.get()),
+                               m_SizingFieldOutput.GetPointer());
+    }
+  }
+  else
+  {
+    m_SizingFieldOutput = nullptr;
+  }
 
-  volume->setSizingField(sizingField[0]);
+  volume->setSizingField(m_SizingField.get());
+  this->CompleteStage("SizingField", 0.25f, !computeSizingField);
 
-  mesher.setConstant(false);
-  cleaver::TetMesh * bgMesh = mesher.createBackgroundMesh(verbose);
+  // The background mesh is cleaved in place into the output mesh; the caller owns it.
+  mesher->setConstant(false);
+  std::unique_ptr<cleaver::TetMesh> backgroundMesh(mesher->createBackgroundMesh(verbose));
+  this->CompleteStage("BackgroundMesh", 0.10f);
 
   // Apply Mesh Cleaving
-  mesher.buildAdjacency(verbose);
-  mesher.sampleVolume(verbose);
-  mesher.computeAlphas(verbose);
-  mesher.computeInterfaces(verbose);
-  mesher.generalizeTets(verbose);
-  mesher.snapsAndWarp(verbose);
-  mesher.stencilTets(verbose);
-
-  cleaver::TetMesh * mesh = mesher.getTetMesh();
+  mesher->buildAdjacency(verbose);
+  this->CompleteStage("BuildAdjacency", 0.05f);
+  mesher->sampleVolume(verbose);
+  this->CompleteStage("SampleVolume", 0.05f);
+  mesher->computeAlphas(verbose);
+  this->CompleteStage("ComputeAlphas", 0.02f);
+  mesher->computeInterfaces(verbose);
+  this->CompleteStage("ComputeInterfaces", 0.08f);
+  mesher->generalizeTets(verbose);
+  this->CompleteStage("GeneralizeTets", 0.03f);
+  mesher->snapsAndWarp(verbose);
+  this->CompleteStage("SnapsAndWarp", 0.12f);
+  mesher->stencilTets(verbose);
+  this->CompleteStage("StencilTets", 0.05f);
+
+  cleaver::TetMesh *                mesh = mesher->getTetMesh();
+  std::unique_ptr<cleaver::TetMesh> tetMesh;
+  if (mesh != backgroundMesh.get())
+  {
+    tetMesh.reset(mesh);
+  }
 
   // Strip Exterior Tets
   const bool stripExterior = false;
@@ -438,6 +1469,16 @@ CleaverImageToMeshFilter<TInputImage, TOutputMesh>::GenerateData()
   // Fix jacobians if requested.
   mesh->fixVertexWindup(verbose);
 
+  // Only the mesh is needed from here on. Release the mesher, the volume and, unless they are
+  // cached, the fields before the output conversion.
+  mesher->cleanup();
+  mesher.reset();
+  volume.reset();
+  if (!m_CacheIntermediates)
+  {
+    this->ReleaseCache();
+  }
+
   // mesh->writePly("/tmp/out.ply");
 
   // Compute Quality If Havn't Already
@@ -445,239 +1486,191 @@ CleaverImageToMeshFilter<TInputImage, TOutputMesh>::GenerateData()
   // std::cout << "Min Dihedral: " << mesh->min_angle << std::endl;
   // std::cout << "Max Dihedral: " << mesh->max_angle << std::endl;
 
-  //         Create Pruned Vertex List
-  class vec3_compare
-  {
-  public:
-    bool
-    operator()(const cleaver::vec3 & a, const cleaver::vec3 & b) const
-    {
-      if ((a.x < b.x) && (b.x - a.x) > 1e-9)
-        return true;
-      else if ((a.x > b.x) && (a.x - b.x) > 1e-9)
-        return false;
-      if ((a.y < b.y) && (b.y - a.y) > 1e-9)
-        return true;
-      else if ((a.y > b.y) && (a.y - b.y) > 1e-9)
-        return false;
-      if ((a.z < b.z) && (b.z - a.z) > 1e-9)
-        return true;
-      else if ((a.z > b.z) && (a.z - b.z) > 1e-9)
-        return false;
-      return false;
-    }
-  };
-
-  using VertMap = std::map<const cleaver::vec3, size_t, vec3_compare>;
-  VertMap                    vertMap;
-  std::vector<cleaver::vec3> prunedVerts;
-  size_t                     prunedPos = 0;
-  for (size_t t = 0; t < mesh->tets.size(); t++)
+  // Vertices closer than this in every coordinate become one output point.
+  constexpr double vertexTolerance = 1e-9;
+
+  // Cleaver coordinates start at the meshed region; move them back to the frame of the full input.
+  const auto    inputSpacing = this->GetInput(0)->GetSpacing();
+  const auto    inputStart = this->GetInput(0)->GetLargestPossibleRegion().GetIndex();
+  cleaver::vec3 offset;
+  offset.x = (m_MeshedRegion.GetIndex(0) - inputStart[0]) * inputSpacing[0];
+  offset.y = (m_MeshedRegion.GetIndex(1) - inputStart[1]) * inputSpacing[1];
+  offset.z = (m_MeshedRegion.GetIndex(2) - inputStart[2]) * inputSpacing[2];
+
+  // Gather the points and cells of the outputs, then release the cleaver mesh before filling them.
+  std::vector<cleaver::vec3>  tetPoints;
+  std::vector<IdentifierType> tetPointIds;
+  std::vector<int>            tetLabels;
+  if (m_GenerateTetrahedralMesh)
   {
-    cleaver::Tet * tet = mesh->tets[t];
-
-    cleaver::Vertex * v1 = tet->verts[0];
-    cleaver::Vertex * v2 = tet->verts[1];
-    cleaver::Vertex * v3 = tet->verts[2];
-    cleaver::Vertex * v4 = tet->verts[3];
-
-    cleaver::vec3 p1 = v1->pos();
-    cleaver::vec3 p2 = v2->pos();
-    cleaver::vec3 p3 = v3->pos();
-    cleaver::vec3 p4 = v4->pos();
-
-    if (!vertMap.count(p1))
-    {
-      vertMap.insert(std::pair<cleaver::vec3, size_t>(p1, prunedPos));
-      prunedPos++;
-      prunedVerts.push_back(p1);
-    }
-    if (!vertMap.count(p2))
-    {
-      vertMap.insert(std::pair<cleaver::vec3, size_t>(p2, prunedPos));
-      prunedPos++;
-      prunedVerts.push_back(p2);
-    }
-    if (!vertMap.count(p3))
-    {
-      vertMap.insert(std::pair<cleaver::vec3, size_t>(p3, prunedPos));
-      prunedPos++;
-      prunedVerts.push_back(p3);
-    }
-    if (!vertMap.count(p4))
+    VertexIndexer tetIndexer(mesh, vertexTolerance);
+    tetPointIds.resize(4 * mesh->tets.size());
+    tetLabels.resize(mesh->tets.size());
+    for (size_t t = 0; t < mesh->tets.size(); t++)
     {
-      vertMap.insert(std::pair<cleaver::vec3, size_t>(p4, prunedPos));
-      prunedPos++;
-      prunedVerts.push_back(p4);
+      cleaver::Tet * tet = mesh->tets[t];
+      for (unsigned int v = 0; v < 4; v++)
+      {
+        tetPointIds[4 * t + v] = tetIndexer.GetId(tet->verts[v]);
+      }
+      tetLabels[t] = tet->mat_label;
     }
+    tetPoints = tetIndexer.TakePoints();
   }
 
-  OutputMeshType * tetOutput = this->GetOutput(0);
-  using CellType = typename OutputMeshType::CellType;
-
-  for (size_t ii = 0; ii < prunedVerts.size(); ii++)
-  {
-    typename OutputMeshType::PointType point;
-    point[0] = prunedVerts[ii].x;
-    point[1] = prunedVerts[ii].y;
-    point[2] = prunedVerts[ii].z;
-    tetOutput->SetPoint(ii, point);
-  }
-
-  using CellDataContainerType = typename OutputMeshType::CellDataContainer;
-  auto outputCellData = CellDataContainerType::New();
-  outputCellData->Reserve(mesh->tets.size());
-  for (size_t ii = 0; ii < mesh->tets.size(); ii++)
+  std::vector<cleaver::vec3>  trianglePoints;
+  std::vector<IdentifierType> trianglePointIds;
+  std::vector<size_t>         triangleCellData;
+  if (m_GenerateTriangleMesh)
   {
-    const cleaver::Tet * t = mesh->tets.at(ii);
-
-    cleaver::Vertex * v1 = t->verts[0];
-    cleaver::Vertex * v2 = t->verts[1];
-    cleaver::Vertex * v3 = t->verts[2];
-    cleaver::Vertex * v4 = t->verts[3];
-    const size_t      i1 = vertMap.find(v1->pos())->second;
-    const size_t      i2 = vertMap.find(v2->pos())->second;
-    const size_t      i3 = vertMap.find(v3->pos())->second;
-    const size_t      i4 = vertMap.find(v4->pos())->second;
-
-    typename CellType::CellAutoPointer cell;
-    using TetrahedronCellType = TetrahedronCell<CellType>;
-    cell.TakeOwnership(new TetrahedronCellType);
-
-    cell->SetPointId(0, i1);
-    cell->SetPointId(1, i2);
-    cell->SetPointId(2, i3);
-    cell->SetPointId(3, i4);
-
-    tetOutput->SetCell(ii, cell);
-
-    outputCellData->SetElement(ii, t->mat_label);
-  }
-  tetOutput->SetCellData(outputCellData);
-
-
-  OutputMeshType * triangleOutput = this->GetOutput(1);
-
-  std::vector<size_t> interfaces;
-  std::vector<size_t> triangleCellData;
-  std::vector<size_t> keys;
+    // Key of the pair of materials each face separates, zero for faces within a material. The faces
+    // are classified concurrently and gathered in face order, so the output does not depend on the
+    // number of work units.
+    std::vector<std::uint64_t> faceKeys(mesh->faces.size(), 0);
+    this->GetMultiThreader()->ParallelizeArray(
+      0,
+      mesh->faces.size(),
+      [mesh, &faceKeys](SizeValueType f) {
+        const int t1Index = static_cast<int>(mesh->faces[f]->tets[0]);
+        const int t2Index = static_cast<int>(mesh->faces[f]->tets[1]);
+
+        if (t1Index < 0 || t2Index < 0)
+        {
+          return;
+        }
 
-  // determine output faces and vertices vertex counts
-  for (size_t f = 0; f < mesh->faces.size(); f++)
-  {
-    const int t1Index = static_cast<int>(mesh->faces[f]->tets[0]);
-    const int t2Index = static_cast<int>(mesh->faces[f]->tets[1]);
+        const cleaver::Tet * t1 = mesh->tets[t1Index];
+        const cleaver::Tet * t2 = mesh->tets[t2Index];
 
-    if (t1Index < 0 || t2Index < 0)
-    {
-      continue;
-    }
+        if (t1->mat_label != t2->mat_label)
+        {
+          const auto lower = static_cast<std::uint64_t>(std::min<int>(t1->mat_label, t2->mat_label));
+          const auto upper = static_cast<std::uint64_t>(std::max<int>(t1->mat_label, t2->mat_label));
+          faceKeys[f] = (lower << 32) + upper;
+        }
+      },
+      nullptr);
 
-    const cleaver::Tet * t1 = mesh->tets[t1Index];
-    const cleaver::Tet * t2 = mesh->tets[t2Index];
+    std::vector<size_t>        interfaces;
+    std::vector<std::uint64_t> keys;
 
-    if (t1->mat_label != t2->mat_label)
+    // determine output faces and vertices vertex counts
+    for (size_t f = 0; f < mesh->faces.size(); f++)
     {
-      interfaces.push_back(f);
-
-      const int triangleCellDataKey = (1 << (int)t1->mat_label) + (1 << (int)t2->mat_label);
-      int       cellDataId = -1;
-      for (size_t k = 0; k < keys.size(); k++)
+      if (faceKeys[f] != 0)
       {
-        if (keys[k] == triangleCellDataKey)
+        interfaces.push_back(f);
+
+        const std::uint64_t triangleCellDataKey = faceKeys[f];
+        int                 cellDataId = -1;
+        for (size_t k = 0; k < keys.size(); k++)
+        {
+          if (keys[k] == triangleCellDataKey)
+          {
+            cellDataId = static_cast<int>(k);
+            break;
+          }
+        }
+        if (cellDataId == -1)
         {
-          cellDataId = static_cast<int>(k);
-          break;
+          keys.push_back(triangleCellDataKey);
+          cellDataId = static_cast<int>(keys.size() - 1);
         }
+
+        triangleCellData.push_back(cellDataId);
       }
-      if (cellDataId == -1)
+    }
+
+    VertexIndexer triangleIndexer(mesh, vertexTolerance);
+    trianglePointIds.resize(3 * interfaces.size());
+    for (size_t f = 0; f < interfaces.size(); f++)
+    {
+      cleaver::Face * face = mesh->faces[interfaces[f]];
+      for (unsigned int v = 0; v < 3; v++)
       {
-        keys.push_back(triangleCellDataKey);
-        cellDataId = static_cast<int>(keys.size() - 1);
+        trianglePointIds[3 * f + v] = triangleIndexer.GetId(mesh->verts[face->verts[v]]);
       }
-
-      triangleCellData.push_back(cellDataId);
     }
+    trianglePoints = triangleIndexer.TakePoints();
   }
 
-  //         Create Pruned Vertex List
-  VertMap                    triangleVertMap;
-  std::vector<cleaver::vec3> trianglePrunedVerts;
-  prunedPos = 0;
-  for (size_t f = 0; f < interfaces.size(); f++)
-  {
-    cleaver::Face * face = mesh->faces[interfaces[f]];
-
-    cleaver::Vertex * v1 = mesh->verts[face->verts[0]];
-    cleaver::Vertex * v2 = mesh->verts[face->verts[1]];
-    cleaver::Vertex * v3 = mesh->verts[face->verts[2]];
+  mesh = nullptr;
+  tetMesh.reset();
+  backgroundMesh.reset();
+  this->CheckAbort();
 
-    cleaver::vec3 p1 = v1->pos();
-    cleaver::vec3 p2 = v2->pos();
-    cleaver::vec3 p3 = v3->pos();
-
-    if (!triangleVertMap.count(p1))
+  using CellType = typename OutputMeshType::CellType;
+  for (unsigned int ii = 0; ii < 2; ii++)
+  {
+    this->GetOutput(ii)->Initialize();
+    m_CompactPoints[ii] = nullptr;
+    m_CompactConnectivity[ii] = nullptr;
+    m_CompactLabels[ii] = nullptr;
+  }
+  const auto checkCompactIds = [this](SizeValueType numberOfPoints) {
+    if (numberOfPoints > std::numeric_limits<typename CompactConnectivityContainer::Element>::max())
     {
-      triangleVertMap.insert(std::pair<cleaver::vec3, size_t>(p1, prunedPos));
-      prunedPos++;
-      trianglePrunedVerts.push_back(p1);
+      itkExceptionMacro("The " << numberOfPoints << " points of the mesh exceed the compact connectivity range.");
     }
-    if (!triangleVertMap.count(p2))
+  };
+
+  if (m_GenerateTetrahedralMesh)
+  {
+    if (m_GenerateCompactOutput)
     {
-      triangleVertMap.insert(std::pair<cleaver::vec3, size_t>(p2, prunedPos));
-      prunedPos++;
-      trianglePrunedVerts.push_back(p2);
+      checkCompactIds(tetPoints.size());
+      m_CompactPoints[0] = CompactPointsContainer::New();
+      m_CompactConnectivity[0] = CompactConnectivityContainer::New();
+      m_CompactLabels[0] = CompactLabelsContainer::New();
+      fillCompactMesh(m_CompactPoints[0].GetPointer(),
+                      m_CompactConnectivity[0].GetPointer(),
+                      m_CompactLabels[0].GetPointer(),
+                      tetPoints,
+                      offset,
+                      tetPointIds,
+                      tetLabels,
+                      this->GetMultiThreader());
     }
-    if (!triangleVertMap.count(p3))
+    else
     {
-      triangleVertMap.insert(std::pair<cleaver::vec3, size_t>(p3, prunedPos));
-      prunedPos++;
-      trianglePrunedVerts.push_back(p3);
+      fillMesh<TetrahedronCell<CellType>>(
+        this->GetOutput(0), tetPoints, offset, tetPointIds, tetLabels, this->GetMultiThreader());
     }
+    tetPoints = {};
+    tetPointIds = {};
+    tetLabels = {};
+    this->CheckAbort();
   }
 
-  for (size_t ii = 0; ii < trianglePrunedVerts.size(); ii++)
-  {
-    typename OutputMeshType::PointType point;
-    point[0] = trianglePrunedVerts[ii].x;
-    point[1] = trianglePrunedVerts[ii].y;
-    point[2] = trianglePrunedVerts[ii].z;
-    triangleOutput->SetPoint(ii, point);
-  }
-
-  auto triangleOutputCellData = CellDataContainerType::New();
-  triangleOutputCellData->Reserve(interfaces.size());
-  for (size_t f = 0; f < interfaces.size(); f++)
+  if (m_GenerateTriangleMesh)
   {
-    cleaver::Face * face = mesh->faces[interfaces[f]];
-
-    cleaver::Vertex * v1 = mesh->verts[face->verts[0]];
-    cleaver::Vertex * v2 = mesh->verts[face->verts[1]];
-    cleaver::Vertex * v3 = mesh->verts[face->verts[2]];
-    size_t            i1 = triangleVertMap.find(v1->pos())->second;
-    size_t            i2 = triangleVertMap.find(v2->pos())->second;
-    size_t            i3 = triangleVertMap.find(v3->pos())->second;
-
-    typename CellType::CellAutoPointer cell;
-    using TriangleCellType = TriangleCell<CellType>;
-    cell.TakeOwnership(new TriangleCellType);
-
-    cell->SetPointId(0, i1);
-    cell->SetPointId(1, i2);
-    cell->SetPointId(2, i3);
-
-    triangleOutput->SetCell(f, cell);
-
-    triangleOutputCellData->SetElement(f, triangleCellData[f]);
-  }
-  triangleOutput->SetCellData(triangleOutputCellData);
-
-  for (auto field : fields)
-  {
-    delete field;
+    if (m_GenerateCompactOutput)
+    {
+      checkCompactIds(trianglePoints.size());
+      m_CompactPoints[1] = CompactPointsContainer::New();
+      m_CompactConnectivity[1] = CompactConnectivityContainer::New();
+      m_CompactLabels[1] = CompactLabelsContainer::New();
+      fillCompactMesh(m_CompactPoints[1].GetPointer(),
+                      m_CompactConnectivity[1].GetPointer(),
+                      m_CompactLabels[1].GetPointer(),
+                      trianglePoints,
+                      offset,
+                      trianglePointIds,
+                      triangleCellData,
+                      this->GetMultiThreader());
+    }
+    else
+    {
+      fillMesh<TriangleCell<CellType>>(this->GetOutput(1),
+                                       trianglePoints,
+                                       offset,
+                                       trianglePointIds,
+                                       triangleCellData,
+                                       this->GetMultiThreader());
+    }
   }
 
-  mesher.cleanup();
+  this->CompleteStage("Output", 0.10f);
 }
 
 } // end namespace itk
@@ -0,0 +1,351 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkCleaverSparseScalarField_h
+#define itkCleaverSparseScalarField_h
+
+#include "itkImage.h"
+
+#include "cleaver/ScalarField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace itk
+{
+
+/** \class CleaverSparseScalarField
+ *
+ * \brief Cleaver float field that stores values only near its zero crossing.
+ *
+ * The grid of the field is split into blocks of BlockSize^3 voxels. Blocks
+ * within NarrowBandWidth voxels of a sign change keep their values. Every
+ * other block keeps a single value: the largest magnitude stored in the band,
+ * with the sign of the block. The memory of an indicator function then grows
+ * with the area of its interface rather than with the volume.
+ *
+ * The values are given by an image whose buffered region may be a subregion
+ * of the grid; voxels of the grid outside of it are taken to be outside of
+ * the material. Like cleaver::FloatField, valueAt() interpolates trilinearly
+ * between voxel centers and clamps at the border of the grid. There is no
+ * dense buffer: data() is null, so the values are only reachable through
+ * valueAt().
+ *
+ * \ingroup Cleaver
+ */
+template <typename TImage>
+class CleaverSparseScalarField : public cleaver::FloatField
+{
+public:
+  using ImageType = TImage;
+  using RegionType = typename ImageType::RegionType;
+
+  static_assert(std::is_same<typename ImageType::PixelType, float>::value,
+                "CleaverSparseScalarField requires a float pixel type.");
+  static_assert(ImageType::ImageDimension == 3, "CleaverSparseScalarField requires a 3D image.");
+
+  static constexpr SizeValueType BlockSize = 8;
+
+  /** Number of voxels the stored blocks may extend past a sign change. The
+   * buffered region of the image should cover the sign changes grown by this
+   * margin for the stored values to be exact. */
+  static SizeValueType
+  GetBandMargin(unsigned int narrowBandWidth)
+  {
+    return (BlockDilation(narrowBandWidth) + 1) * BlockSize;
+  }
+
+  /** Build the field on the grid of region from the buffered values of
+   * image, negated when negate is true, and record the outcome of the same
+   * checks as CleaverImageScalarField::Validate() with setError(). */
+  CleaverSparseScalarField(const ImageType * image, const RegionType & region, unsigned int narrowBandWidth, bool negate)
+    : cleaver::FloatField(nullptr,
+                          static_cast<int>(region.GetSize()[0]),
+                          static_cast<int>(region.GetSize()[1]),
+                          static_cast<int>(region.GetSize()[2]))
+  {
+    const auto spacing = image->GetSpacing();
+    this->setScale(cleaver::vec3(spacing[0], spacing[1], spacing[2]));
+
+    for (unsigned int d = 0; d < 3; d++)
+    {
+      m_Size[d] = static_cast<IndexValueType>(region.GetSize()[d]);
+      m_Blocks[d] = (static_cast<SizeValueType>(m_Size[d]) + BlockSize - 1) / BlockSize;
+    }
+    m_Dense.resize(m_Blocks[0] * m_Blocks[1] * m_Blocks[2]);
+    m_Constant.resize(m_Dense.size());
+
+    // Values are read in the coordinates of the grid.
+    RegionType buffered = image->GetBufferedRegion();
+    buffered.Crop(region);
+    IndexValueType begin[3];
+    IndexValueType end[3];
+    IndexValueType offset[3];
+    for (unsigned int d = 0; d < 3; d++)
+    {
+      begin[d] = buffered.GetIndex(d) - region.GetIndex(d);
+      end[d] = begin[d] + static_cast<IndexValueType>(buffered.GetSize(d));
+      offset[d] = buffered.GetIndex(d) - image->GetBufferedRegion().GetIndex(d);
+    }
+    const float * const  buffer = image->GetBufferPointer();
+    const IndexValueType stride1 = image->GetBufferedRegion().GetSize(0);
+    const IndexValueType stride2 = stride1 * static_cast<IndexValueType>(image->GetBufferedRegion().GetSize(1));
+    const float          sign = negate ? -1.0f : 1.0f;
+    const auto inside = [&](IndexValueType i, IndexValueType j, IndexValueType k) {
+      return i >= begin[0] && i < end[0] && j >= begin[1] && j < end[1] && k >= begin[2] && k < end[2];
+    };
+    const auto value = [&](IndexValueType i, IndexValueType j, IndexValueType k) {
+      return sign * buffer[(k - begin[2] + offset[2]) * stride2 + (j - begin[1] + offset[1]) * stride1 +
+                           (i - begin[0] + offset[0])];
+    };
+
+    // Blocks whose voxels, or the voxels right after them, change sign.
+    bool                 nan = false;
+    float                min = std::numeric_limits<float>::max();
+    float                max = std::numeric_limits<float>::lowest();
+    std::vector<uint8_t> crossing(m_Dense.size(), 0);
+    for (SizeValueType bk = 0; bk < m_Blocks[2]; bk++)
+    {
+      for (SizeValueType bj = 0; bj < m_Blocks[1]; bj++)
+      {
+        for (SizeValueType bi = 0; bi < m_Blocks[0]; bi++)
+        {
+          const SizeValueType block = BlockId(bi, bj, bk);
+          bool                positive = false;
+          bool                nonPositive = false;
+          ForEachVoxel(bi, bj, bk, 1, [&](IndexValueType i, IndexValueType j, IndexValueType k) {
+            const float v = inside(i, j, k) ? value(i, j, k) : -1.0f;
+            positive |= v > 0.0f;
+            nonPositive |= v <= 0.0f;
+          });
+          crossing[block] = positive && nonPositive;
+          m_Constant[block] = positive ? 1.0f : -1.0f;
+        }
+      }
+    }
+    for (IndexValueType k = begin[2]; k < end[2]; k++)
+    {
+      for (IndexValueType j = begin[1]; j < end[1]; j++)
+      {
+        for (IndexValueType i = begin[0]; i < end[0]; i++)
+        {
+          const float v = value(i, j, k);
+          nan |= (v != v);
+          min = std::min(min, v);
+          max = std::max(max, v);
+        }
+      }
+    }
+
+    // Grow the crossings by the narrow band, in blocks.
+    const auto dilation = static_cast<IndexValueType>(BlockDilation(narrowBandWidth));
+    float      magnitude = 0.0f;
+    for (SizeValueType bk = 0; bk < m_Blocks[2]; bk++)
+    {
+      for (SizeValueType bj = 0; bj < m_Blocks[1]; bj++)
+      {
+        for (SizeValueType bi = 0; bi < m_Blocks[0]; bi++)
+        {
+          bool band = false;
+          for (IndexValueType dk = -dilation; dk <= dilation && !band; dk++)
+          {
+            for (IndexValueType dj = -dilation; dj <= dilation && !band; dj++)
+            {
+              for (IndexValueType di = -dilation; di <= dilation && !band; di++)
+              {
+                const IndexValueType ni = static_cast<IndexValueType>(bi) + di;
+                const IndexValueType nj = static_cast<IndexValueType>(bj) + dj;
+                const IndexValueType nk = static_cast<IndexValueType>(bk) + dk;
+                band = ni >= 0 && nj >= 0 && nk >= 0 && ni < static_cast<IndexValueType>(m_Blocks[0]) &&
+                       nj < static_cast<IndexValueType>(m_Blocks[1]) &&
+                       nk < static_cast<IndexValueType>(m_Blocks[2]) && crossing[BlockId(ni, nj, nk)];
+              }
+            }
+          }
+          if (!band)
+          {
+            continue;
+          }
+          auto values = std::make_unique<float[]>(BlockSize * BlockSize * BlockSize);
+          ForEachVoxel(bi, bj, bk, 0, [&](IndexValueType i, IndexValueType j, IndexValueType k) {
+            float v = std::numeric_limits<float>::quiet_NaN();
+            if (inside(i, j, k))
+            {
+              v = value(i, j, k);
+              magnitude = std::max(magnitude, std::abs(v));
+            }
+            values[VoxelId(i, j, k)] = v;
+          });
+          m_Dense[BlockId(bi, bj, bk)] = std::move(values);
+          ++m_NumberOfDenseBlocks;
+        }
+      }
+    }
+    if (m_NumberOfDenseBlocks == 0)
+    {
+      magnitude = std::max(std::abs(min), std::abs(max));
+    }
+
+    // Outside of the values, and away from the band, the magnitude is clamped.
+    for (auto & constant : m_Constant)
+    {
+      constant *= magnitude;
+    }
+    for (auto & values : m_Dense)
+    {
+      if (values)
+      {
+        for (SizeValueType ii = 0; ii < BlockSize * BlockSize * BlockSize; ii++)
+        {
+          if (values[ii] != values[ii] && !nan)
+          {
+            values[ii] = -magnitude;
+          }
+        }
+      }
+    }
+
+    if (nan)
+    {
+      this->setError("nan");
+    }
+    else if (max <= 0 || (min >= 0 && buffered == region))
+    {
+      this->setError("maxmin");
+    }
+    else
+    {
+      this->setError("none");
+    }
+  }
+
+  CleaverSparseScalarField(const CleaverSparseScalarField &) = delete;
+  CleaverSparseScalarField &
+  operator=(const CleaverSparseScalarField &) = delete;
+
+  double
+  valueAt(double x, double y, double z) const override
+  {
+    const cleaver::vec3 scale = this->scale();
+    const double        position[3] = { x / scale.x - 0.5, y / scale.y - 0.5, z / scale.z - 0.5 };
+    IndexValueType      lower[3];
+    IndexValueType      upper[3];
+    double              t[3];
+    for (unsigned int d = 0; d < 3; d++)
+    {
+      const double base = std::floor(position[d]);
+      t[d] = position[d] - base;
+      lower[d] = std::clamp(static_cast<IndexValueType>(base), IndexValueType{ 0 }, m_Size[d] - 1);
+      upper[d] = std::clamp(static_cast<IndexValueType>(base) + 1, IndexValueType{ 0 }, m_Size[d] - 1);
+    }
+
+    const double c00 = (1 - t[0]) * Voxel(lower[0], lower[1], lower[2]) + t[0] * Voxel(upper[0], lower[1], lower[2]);
+    const double c10 = (1 - t[0]) * Voxel(lower[0], upper[1], lower[2]) + t[0] * Voxel(upper[0], upper[1], lower[2]);
+    const double c01 = (1 - t[0]) * Voxel(lower[0], lower[1], upper[2]) + t[0] * Voxel(upper[0], lower[1], upper[2]);
+    const double c11 = (1 - t[0]) * Voxel(lower[0], upper[1], upper[2]) + t[0] * Voxel(upper[0], upper[1], upper[2]);
+    const double c0 = (1 - t[1]) * c00 + t[1] * c10;
+    const double c1 = (1 - t[1]) * c01 + t[1] * c11;
+    return (1 - t[2]) * c0 + t[2] * c1;
+  }
+
+  double
+  valueAt(const cleaver::vec3 & x) const override
+  {
+    return this->valueAt(x.x, x.y, x.z);
+  }
+
+  /** Number of blocks that store their values. */
+  SizeValueType
+  GetNumberOfDenseBlocks() const
+  {
+    return m_NumberOfDenseBlocks;
+  }
+
+  /** Approximate memory held by the values, in bytes. */
+  SizeValueType
+  GetMemorySize() const
+  {
+    return m_NumberOfDenseBlocks * BlockSize * BlockSize * BlockSize * sizeof(float) +
+           m_Dense.size() * (sizeof(std::unique_ptr<float[]>) + sizeof(float));
+  }
+
+private:
+  static SizeValueType
+  BlockDilation(unsigned int narrowBandWidth)
+  {
+    return std::max<SizeValueType>(1, (narrowBandWidth + BlockSize - 1) / BlockSize);
+  }
+
+  SizeValueType
+  BlockId(SizeValueType bi, SizeValueType bj, SizeValueType bk) const
+  {
+    return (bk * m_Blocks[1] + bj) * m_Blocks[0] + bi;
+  }
+
+  static SizeValueType
+  VoxelId(IndexValueType i, IndexValueType j, IndexValueType k)
+  {
+    return ((k % BlockSize) * BlockSize + (j % BlockSize)) * BlockSize + (i % BlockSize);
+  }
+
+  /** Call fn on the voxels of a block, grown by extra voxels after its end,
+   * within the grid. */
+  template <typename TFunction>
+  void
+  ForEachVoxel(SizeValueType bi, SizeValueType bj, SizeValueType bk, SizeValueType extra, TFunction && fn) const
+  {
+    const auto i0 = static_cast<IndexValueType>(bi * BlockSize);
+    const auto j0 = static_cast<IndexValueType>(bj * BlockSize);
+    const auto k0 = static_cast<IndexValueType>(bk * BlockSize);
+    const auto           grow = static_cast<IndexValueType>(BlockSize + extra);
+    const IndexValueType i1 = std::min(i0 + grow, m_Size[0]);
+    const IndexValueType j1 = std::min(j0 + grow, m_Size[1]);
+    const IndexValueType k1 = std::min(k0 + grow, m_Size[2]);
+    for (IndexValueType k = k0; k < k1; k++)
+    {
+      for (IndexValueType j = j0; j < j1; j++)
+      {
+        for (IndexValueType i = i0; i < i1; i++)
+        {
+          fn(i, j, k);
+        }
+      }
+    }
+  }
+
+  float
+  Voxel(IndexValueType i, IndexValueType j, IndexValueType k) const
+  {
+    const SizeValueType block = BlockId(i / BlockSize, j / BlockSize, k / BlockSize);
+    const auto &        values = m_Dense[block];
+    return values ? values[VoxelId(i, j, k)] : m_Constant[block];
+  }
+
+  IndexValueType                        m_Size[3];
+  SizeValueType                         m_Blocks[3];
+  std::vector<std::unique_ptr<float[]>> m_Dense;
+  std::vector<float>                    m_Constant;
+  SizeValueType                         m_NumberOfDenseBlocks{ 0 };
+};
+
+} // end namespace itk
+
+#endif // itkCleaverSparseScalarField_h
@@ -0,0 +1,132 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCleaverBatchMesher.h"
+
+#include "itkImageFileReader.h"
+#include "itkTestingMacros.h"
+#include "itkMesh.h"
+
+int
+itkCleaverBatchMesherTest(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << itkNameOfTestExecutableMacro(argv);
+    std::cerr << " inputLabelImage";
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+  const char * inputImageFileName = argv[1];
+
+  constexpr unsigned int Dimension = 3;
+  using PixelType = float;
+  using ImageType = itk::Image<PixelType, Dimension>;
+  using MeshType = itk::Mesh<PixelType, Dimension>;
+
+  using BatchMesherType = itk::CleaverBatchMesher<ImageType, MeshType>;
+  BatchMesherType::Pointer batchMesher = BatchMesherType::New();
+
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(batchMesher, CleaverBatchMesher, Object);
+
+  auto prototype = BatchMesherType::FilterType::New();
+  prototype->SetAlpha(0.3);
+  batchMesher->SetPrototype(prototype);
+  ITK_TEST_SET_GET_VALUE(prototype, batchMesher->GetPrototype());
+
+  batchMesher->SetNumberOfConcurrentSubjects(2);
+  ITK_TEST_SET_GET_VALUE(2, batchMesher->GetNumberOfConcurrentSubjects());
+  batchMesher->SetMemoryBudget(1024);
+  ITK_TEST_SET_GET_VALUE(1024, batchMesher->GetMemoryBudget());
+  batchMesher->SetExpectedNumberOfLabels(3);
+  ITK_TEST_SET_GET_VALUE(3, batchMesher->GetExpectedNumberOfLabels());
+
+  // Two copies of the same label image mesh to the same result.
+  auto       labelImage = itk::ReadImage<ImageType>(inputImageFileName);
+  const auto first = batchMesher->AddSubject(labelImage);
+  const auto second = batchMesher->AddSubject(itk::ReadImage<ImageType>(inputImageFileName));
+
+  // Constant indicator functions have no zero crossing.
+  auto constant = ImageType::New();
+  constant->CopyInformation(labelImage);
+  constant->SetRegions(labelImage->GetLargestPossibleRegion());
+  constant->Allocate();
+  constant->FillBuffer(1.0f);
+  auto constant2 = ImageType::New();
+  constant2->Graft(constant);
+  const auto failing = batchMesher->AddSubject(constant);
+  batchMesher->AddSubjectInput(failing, constant2);
+  ITK_TEST_EXPECT_EQUAL(batchMesher->GetNumberOfSubjects(), 3);
+
+  std::cout << "Estimated memory of the first subject: " << batchMesher->EstimateSubjectMemory(first) << " bytes"
+            << std::endl;
+
+  // The memory of a subject whose reader has not run is estimated from its output information.
+  {
+    auto estimator = BatchMesherType::New();
+    auto reader = itk::ImageFileReader<ImageType>::New();
+    reader->SetFileName(inputImageFileName);
+    estimator->SetExpectedNumberOfLabels(batchMesher->GetExpectedNumberOfLabels());
+    const auto unread = estimator->AddSubject(reader->GetOutput());
+    ITK_TEST_EXPECT_EQUAL(estimator->EstimateSubjectMemory(unread), batchMesher->EstimateSubjectMemory(first));
+    ITK_TEST_EXPECT_EQUAL(reader->GetOutput()->GetBufferedRegion().GetNumberOfPixels(), 0);
+  }
+  ITK_TEST_EXPECT_EQUAL(batchMesher->GetNumberOfFailedSubjects(), 0);
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(batchMesher->Compute());
+
+  ITK_TEST_EXPECT_TRUE(batchMesher->GetSubjectSucceeded(first));
+  ITK_TEST_EXPECT_TRUE(batchMesher->GetSubjectSucceeded(second));
+  ITK_TEST_EXPECT_TRUE(!batchMesher->GetSubjectSucceeded(failing));
+  ITK_TEST_EXPECT_EQUAL(batchMesher->GetNumberOfFailedSubjects(), 1);
+  std::cout << "Error of the failing subject: " << batchMesher->GetSubjectError(failing) << std::endl;
+  ITK_TEST_EXPECT_TRUE(!batchMesher->GetSubjectError(failing).empty());
+  ITK_TEST_EXPECT_TRUE(batchMesher->GetTetrahedralMesh(failing) == nullptr);
+
+  ITK_TEST_EXPECT_EQUAL(batchMesher->GetTetrahedralMesh(first)->GetNumberOfCells(),
+                        batchMesher->GetTetrahedralMesh(second)->GetNumberOfCells());
+  ITK_TEST_EXPECT_EQUAL(batchMesher->GetTriangleMesh(first)->GetNumberOfCells(),
+                        batchMesher->GetTriangleMesh(second)->GetNumberOfCells());
+  ITK_TEST_EXPECT_TRUE(!batchMesher->GetSubjectStageStatistics(first).empty());
+
+  ITK_TRY_EXPECT_EXCEPTION(batchMesher->GetSubjectSucceeded(3));
+
+  // The compact outputs of the prototype are kept per subject.
+  {
+    auto compactPrototype = BatchMesherType::FilterType::New();
+    compactPrototype->SetAlpha(prototype->GetAlpha());
+    compactPrototype->GenerateCompactOutputOn();
+    auto compactBatchMesher = BatchMesherType::New();
+    compactBatchMesher->SetPrototype(compactPrototype);
+    const auto compactSubject = compactBatchMesher->AddSubject(itk::ReadImage<ImageType>(inputImageFileName));
+    ITK_TRY_EXPECT_NO_EXCEPTION(compactBatchMesher->Compute());
+    ITK_TEST_EXPECT_TRUE(compactBatchMesher->GetSubjectSucceeded(compactSubject));
+    ITK_TEST_EXPECT_EQUAL(compactBatchMesher->GetCompactLabels(compactSubject, 0)->Size(),
+                          batchMesher->GetTetrahedralMesh(first)->GetNumberOfCells());
+    ITK_TEST_EXPECT_EQUAL(compactBatchMesher->GetCompactConnectivity(compactSubject, 1)->Size(),
+                          3 * batchMesher->GetTriangleMesh(first)->GetNumberOfCells());
+    ITK_TRY_EXPECT_EXCEPTION(compactBatchMesher->GetCompactPoints(compactSubject, 2));
+  }
+
+  batchMesher->ClearSubjects();
+  ITK_TEST_EXPECT_EQUAL(batchMesher->GetNumberOfSubjects(), 0);
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,394 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Meshes procedurally generated label volumes and indicator function stacks
+// and reports per-stage wall time and resident memory, the peak resident
+// memory of each update, throughput and output sizes as JSON or CSV.
+//
+// Resident memory is that of the whole process, sampled at the end of each
+// stage. The peak of a case is the high-water mark of its own update, which
+// the filter resets when the update starts, so earlier cases do not inflate
+// later ones. Where the mark cannot be reset, the peak is the largest
+// stage-end sample, and peak_memory_is_high_water_mark is false. The growth
+// is the peak less the resident memory just before the update.
+//
+// Usage: CleaverBenchmarks output.{json,csv}
+//          [--shapes spheres,voronoi,shells] [--sizes 64,128] [--labels 2,8]
+//          [--inputs label,indicator] [--repetitions 1]
+
+#include "itkCleaverImageToMeshFilter.h"
+
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMemoryUsageObserver.h"
+#include "itkMesh.h"
+#include "itkTimeProbe.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr unsigned int Dimension = 3;
+using PixelType = float;
+using ImageType = itk::Image<PixelType, Dimension>;
+using MeshType = itk::Mesh<PixelType, Dimension>;
+using FilterType = itk::CleaverImageToMeshFilter<ImageType, MeshType>;
+
+struct BenchmarkCase
+{
+  std::string  Shape;
+  unsigned int Size;
+  unsigned int Labels;
+  std::string  Input;
+};
+
+struct BenchmarkResult
+{
+  BenchmarkCase                        Case;
+  unsigned int                         Repetition;
+  double                               Time;
+  FilterType::StageStatisticsContainer Stages;
+  itk::SizeValueType                   BaselineMemory;
+  itk::SizeValueType                   PeakMemory;
+  bool                                 PeakMemoryIsHighWaterMark;
+  itk::SizeValueType                   Points;
+  itk::SizeValueType                   Tetrahedra;
+  itk::SizeValueType                   Triangles;
+};
+
+std::vector<std::string>
+split(const std::string & list)
+{
+  std::vector<std::string> items;
+  std::stringstream        stream(list);
+  std::string              item;
+  while (std::getline(stream, item, ','))
+  {
+    if (!item.empty())
+    {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+// Label volume of the requested shape with labels 0 (background) to labels - 1.
+//  - spheres: nested spheres, the innermost carries the highest label.
+//  - voronoi: Voronoi cells of random seeds, reproducible across runs.
+//  - shells:  concentric shells two voxels thick on an empty background.
+ImageType::Pointer
+makeLabelImage(const std::string & shape, unsigned int size, unsigned int labels)
+{
+  auto                image = ImageType::New();
+  ImageType::SizeType imageSize;
+  imageSize.Fill(size);
+  image->SetRegions(ImageType::RegionType(imageSize));
+  image->Allocate();
+
+  const double center = 0.5 * (size - 1);
+  const double radius = 0.45 * size;
+
+  std::vector<std::array<double, Dimension>> seeds;
+  std::mt19937                               random(labels * 7919u + size);
+  std::uniform_real_distribution<double>     coordinate(0.0, static_cast<double>(size));
+  for (unsigned int ii = 0; ii < labels; ii++)
+  {
+    seeds.push_back({ coordinate(random), coordinate(random), coordinate(random) });
+  }
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    const auto index = it.GetIndex();
+    double     distance = 0.0;
+    for (unsigned int d = 0; d < Dimension; d++)
+    {
+      distance += (index[d] - center) * (index[d] - center);
+    }
+    distance = std::sqrt(distance);
+
+    unsigned int label = 0;
+    if (shape == "voronoi")
+    {
+      double nearest = std::numeric_limits<double>::max();
+      for (unsigned int ii = 0; ii < labels; ii++)
+      {
+        double seedDistance = 0.0;
+        for (unsigned int d = 0; d < Dimension; d++)
+        {
+          seedDistance += (index[d] - seeds[ii][d]) * (index[d] - seeds[ii][d]);
+        }
+        if (seedDistance < nearest)
+        {
+          nearest = seedDistance;
+          label = ii;
+        }
+      }
+    }
+    else if (shape == "shells")
+    {
+      const double spacing = radius / labels;
+      const auto   shell = static_cast<unsigned int>(distance / spacing);
+      if (shell + 1 < labels && distance - shell * spacing >= spacing - 2.0)
+      {
+        label = shell + 1;
+      }
+    }
+    else
+    {
+      if (distance < radius)
+      {
+        label = labels - 1 - std::min(labels - 2, static_cast<unsigned int>(distance / radius * (labels - 1)));
+      }
+    }
+    it.Set(static_cast<PixelType>(label));
+  }
+  return image;
+}
+
+// One indicator function per label: 1 inside the label, -1 outside.
+std::vector<ImageType::Pointer>
+makeIndicatorImages(const ImageType * labelImage, unsigned int labels)
+{
+  std::vector<ImageType::Pointer> indicators;
+  for (unsigned int label = 0; label < labels; label++)
+  {
+    auto indicator = ImageType::New();
+    indicator->CopyInformation(labelImage);
+    indicator->SetRegions(labelImage->GetLargestPossibleRegion());
+    indicator->Allocate();
+    const PixelType *        labelBuffer = labelImage->GetBufferPointer();
+    PixelType *              indicatorBuffer = indicator->GetBufferPointer();
+    const itk::SizeValueType numberOfPixels = labelImage->GetBufferedRegion().GetNumberOfPixels();
+    for (itk::SizeValueType ii = 0; ii < numberOfPixels; ii++)
+    {
+      indicatorBuffer[ii] = labelBuffer[ii] == static_cast<PixelType>(label) ? 1.0f : -1.0f;
+    }
+    indicators.push_back(indicator);
+  }
+  return indicators;
+}
+
+BenchmarkResult
+runCase(const BenchmarkCase & benchmarkCase, unsigned int repetition)
+{
+  auto filter = FilterType::New();
+  {
+    ImageType::Pointer labelImage = makeLabelImage(benchmarkCase.Shape, benchmarkCase.Size, benchmarkCase.Labels);
+    if (benchmarkCase.Input == "indicator")
+    {
+      const auto indicators = makeIndicatorImages(labelImage, benchmarkCase.Labels);
+      for (unsigned int ii = 0; ii < indicators.size(); ii++)
+      {
+        filter->SetInput(ii, indicators[ii]);
+      }
+      filter->InputIsIndicatorFunctionOn();
+    }
+    else
+    {
+      filter->SetInput(labelImage);
+    }
+  }
+
+  itk::MemoryUsageObserver memoryUsage;
+  const auto               baselineMemory = static_cast<itk::SizeValueType>(memoryUsage.GetMemoryUsage());
+
+  itk::TimeProbe probe;
+  probe.Start();
+  filter->Update();
+  probe.Stop();
+
+  BenchmarkResult result;
+  result.Case = benchmarkCase;
+  result.Repetition = repetition;
+  result.Time = probe.GetTotal();
+  result.Stages = filter->GetStageStatistics();
+  result.BaselineMemory = baselineMemory;
+  result.PeakMemory = filter->GetPeakMemoryUsage();
+  result.PeakMemoryIsHighWaterMark = filter->GetPeakMemoryIsHighWaterMark();
+  result.Points = filter->GetOutput(0)->GetNumberOfPoints();
+  result.Tetrahedra = filter->GetOutput(0)->GetNumberOfCells();
+  result.Triangles = filter->GetOutput(1)->GetNumberOfCells();
+  return result;
+}
+
+// Growth of the resident memory of the process during the update of a case, in kilobytes.
+itk::SizeValueType
+memoryGrowth(const BenchmarkResult & result)
+{
+  return result.PeakMemory > result.BaselineMemory ? result.PeakMemory - result.BaselineMemory : 0;
+}
+
+void
+writeJSON(std::ostream & os, const std::vector<BenchmarkResult> & results)
+{
+  os << "[\n";
+  for (size_t ii = 0; ii < results.size(); ii++)
+  {
+    const auto & result = results[ii];
+    os << "  {\"shape\": \"" << result.Case.Shape << "\", \"size\": " << result.Case.Size
+       << ", \"labels\": " << result.Case.Labels << ", \"input\": \"" << result.Case.Input
+       << "\", \"repetition\": " << result.Repetition << ", \"time\": " << result.Time
+       << ", \"baseline_memory_kb\": " << result.BaselineMemory << ", \"peak_memory_kb\": " << result.PeakMemory
+       << ", \"peak_memory_growth_kb\": " << memoryGrowth(result) << ", \"peak_memory_is_high_water_mark\": "
+       << (result.PeakMemoryIsHighWaterMark ? "true" : "false") << ", \"points\": " << result.Points
+       << ", \"tetrahedra\": " << result.Tetrahedra << ", \"triangles\": " << result.Triangles
+       << ", \"tetrahedra_per_second\": " << (result.Time > 0.0 ? result.Tetrahedra / result.Time : 0.0)
+       << ", \"stages\": {";
+    for (size_t jj = 0; jj < result.Stages.size(); jj++)
+    {
+      const auto & stage = result.Stages[jj];
+      os << (jj ? ", " : "") << "\"" << stage.Name << "\": {\"time\": " << stage.Time
+         << ", \"memory_kb\": " << stage.Memory << ", \"peak_memory_kb\": " << stage.PeakMemory << "}";
+    }
+    os << "}}" << (ii + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "]\n";
+}
+
+void
+writeCSV(std::ostream & os, const std::vector<BenchmarkResult> & results)
+{
+  os << "shape,size,labels,input,repetition,time,baseline_memory_kb,peak_memory_kb,peak_memory_growth_kb,"
+        "peak_memory_is_high_water_mark,points,tetrahedra,triangles,tetrahedra_per_second";
+  if (!results.empty())
+  {
+    for (const auto & stage : results.front().Stages)
+    {
+      os << "," << stage.Name << "_time," << stage.Name << "_memory_kb," << stage.Name << "_peak_memory_kb";
+    }
+  }
+  os << "\n";
+  for (const auto & result : results)
+  {
+    os << result.Case.Shape << "," << result.Case.Size << "," << result.Case.Labels << "," << result.Case.Input << ","
+       << result.Repetition << "," << result.Time << "," << result.BaselineMemory << "," << result.PeakMemory << ","
+       << memoryGrowth(result) << "," << result.PeakMemoryIsHighWaterMark << "," << result.Points << ","
+       << result.Tetrahedra << "," << result.Triangles << ","
+       << (result.Time > 0.0 ? result.Tetrahedra / result.Time : 0.0);
+    for (const auto & stage : result.Stages)
+    {
+      os << "," << stage.Time << "," << stage.Memory << "," << stage.PeakMemory;
+    }
+    os << "\n";
+  }
+}
+} // namespace
+
+int
+main(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Missing parameters." << std::endl;
+    std::cerr << "Usage: " << argv[0] << " output.{json,csv}";
+    std::cerr << " [--shapes spheres,voronoi,shells] [--sizes 64,128,256,512] [--labels 2,8,64]";
+    std::cerr << " [--inputs label,indicator] [--repetitions 1]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string outputFileName = argv[1];
+
+  std::vector<std::string> shapes{ "spheres" };
+  std::vector<std::string> sizes{ "64" };
+  std::vector<std::string> labels{ "4" };
+  std::vector<std::string> inputs{ "label" };
+  unsigned int             repetitions = 1;
+  for (int ii = 2; ii + 1 < argc; ii += 2)
+  {
+    const std::string option = argv[ii];
+    const std::string value = argv[ii + 1];
+    if (option == "--shapes")
+    {
+      shapes = split(value);
+    }
+    else if (option == "--sizes")
+    {
+      sizes = split(value);
+    }
+    else if (option == "--labels")
+    {
+      labels = split(value);
+    }
+    else if (option == "--inputs")
+    {
+      inputs = split(value);
+    }
+    else if (option == "--repetitions")
+    {
+      repetitions = static_cast<unsigned int>(std::stoul(value));
+    }
+    else
+    {
+      std::cerr << "Unknown option: " << option << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<BenchmarkResult> results;
+  for (const auto & shape : shapes)
+  {
+    for (const auto & size : sizes)
+    {
+      for (const auto & label : labels)
+      {
+        for (const auto & input : inputs)
+        {
+          const BenchmarkCase benchmarkCase{ shape,
+                                             static_cast<unsigned int>(std::stoul(size)),
+                                             std::max(2u, static_cast<unsigned int>(std::stoul(label))),
+                                             input };
+          for (unsigned int repetition = 0; repetition < repetitions; repetition++)
+          {
+            std::cout << shape << " " << size << "^3, " << benchmarkCase.Labels << " labels, " << input << " input"
+                      << std::endl;
+            try
+            {
+              results.push_back(runCase(benchmarkCase, repetition));
+            }
+            catch (const itk::ExceptionObject & error)
+            {
+              std::cerr << error << std::endl;
+              return EXIT_FAILURE;
+            }
+            std::cout << "  " << results.back().Time << " s, " << results.back().Tetrahedra << " tetrahedra"
+                      << std::endl;
+          }
+        }
+      }
+    }
+  }
+
+  std::ofstream output(outputFileName);
+  if (outputFileName.size() >= 4 && outputFileName.substr(outputFileName.size() - 4) == ".csv")
+  {
+    writeCSV(output, results);
+  }
+  else
+  {
+    writeJSON(output, results);
+  }
+  return output.good() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
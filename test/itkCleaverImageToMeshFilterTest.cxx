@@ -18,12 +18,16 @@
 
 #include "itkCleaverImageToMeshFilter.h"
 
+#include "itkCastImageFilter.h"
 #include "itkCommand.h"
 #include "itkImageFileReader.h"
 #include "itkMeshFileWriter.h"
 #include "itkTestingMacros.h"
 #include "itkMesh.h"
 
+#include <algorithm>
+#include <string>
+
 namespace
 {
 class ShowProgress : public itk::Command
@@ -93,7 +97,24 @@ itkCleaverImageToMeshFilterTest(int argc, char * argv[])
   ShowProgress::Pointer showProgress = ShowProgress::New();
   filter->AddObserver(itk::ProgressEvent(), showProgress);
 
-  filter->Update();
+  ITK_TRY_EXPECT_NO_EXCEPTION(filter->Update());
+  const auto numberOfTetrahedra = filter->GetOutput(0)->GetNumberOfCells();
+
+  std::cout << "\nStage statistics: " << std::endl;
+  ITK_TEST_EXPECT_TRUE(!filter->GetStageStatistics().empty());
+  itk::SizeValueType previousPeakMemory = 0;
+  for (const auto & stage : filter->GetStageStatistics())
+  {
+    std::cout << "  " << stage.Name << ": " << stage.Time << " s, " << stage.Memory << " KB, peak "
+              << stage.PeakMemory << " KB" << std::endl;
+    ITK_TEST_EXPECT_TRUE(stage.PeakMemory >= stage.Memory);
+    ITK_TEST_EXPECT_TRUE(stage.PeakMemory >= previousPeakMemory);
+    previousPeakMemory = stage.PeakMemory;
+  }
+  std::cout << "Memory: " << filter->GetCurrentMemoryUsage() << " KB, peak " << filter->GetPeakMemoryUsage() << " KB"
+            << (filter->GetPeakMemoryIsHighWaterMark() ? " (high-water mark)" : " (sampled at stage ends)")
+            << std::endl;
+  ITK_TEST_EXPECT_TRUE(filter->GetPeakMemoryUsage() >= filter->GetCurrentMemoryUsage());
 
   std::cout << "\nTetrahedral mesh output: " << std::endl;
   filter->GetOutput(0)->Print(std::cout);
@@ -108,6 +129,207 @@ itkCleaverImageToMeshFilterTest(int argc, char * argv[])
 
   ITK_TRY_EXPECT_NO_EXCEPTION(writer->Update());
 
+  // Nothing is cached by default.
+  ITK_TEST_EXPECT_TRUE(!filter->GetCacheIntermediates());
+  for (const auto & stage : filter->GetStageStatistics())
+  {
+    ITK_TEST_EXPECT_TRUE(!stage.Cached);
+  }
+
+  // Whether the stage of the last update reused the cached intermediates.
+  const auto stageCached = [](const FilterType * cachingFilter, const std::string & name) {
+    for (const auto & stage : cachingFilter->GetStageStatistics())
+    {
+      if (stage.Name == name)
+      {
+        return stage.Cached;
+      }
+    }
+    return false;
+  };
+
+  // With caching on, re-meshing with another alpha reuses the indicator
+  // functions and sizing field. The sizing field is exported for the next run.
+  ITK_TEST_SET_GET_BOOLEAN(filter, CacheIntermediates, true);
+  ITK_TEST_SET_GET_BOOLEAN(filter, ExportSizingField, true);
+  ITK_TRY_EXPECT_NO_EXCEPTION(filter->Update());
+  ITK_TEST_EXPECT_TRUE(!stageCached(filter, "IndicatorFunctions"));
+  ITK_TEST_EXPECT_TRUE(!stageCached(filter, "SizingField"));
+  filter->SetAlpha(0.3);
+  ITK_TRY_EXPECT_NO_EXCEPTION(filter->Update());
+  ITK_TEST_EXPECT_TRUE(stageCached(filter, "IndicatorFunctions"));
+  ITK_TEST_EXPECT_TRUE(stageCached(filter, "SizingField"));
+  const FilterType::SizingFieldImageType * sizingField = filter->GetSizingFieldOutput();
+  ITK_TEST_EXPECT_TRUE(sizingField != nullptr);
+
+  // The exported sizing field, with the same parameters, gives the same meshes.
+  FilterType::Pointer sizingFieldFilter = FilterType::New();
+  for (unsigned int ii = 0; ii < filter->GetNumberOfIndexedInputs(); ii++)
+  {
+    sizingFieldFilter->SetInput(ii, filter->GetInput(ii));
+  }
+  sizingFieldFilter->SetAlpha(filter->GetAlpha());
+  sizingFieldFilter->SetSizingField(sizingField);
+  ITK_TRY_EXPECT_NO_EXCEPTION(sizingFieldFilter->Update());
+  for (unsigned int output = 0; output < 2; output++)
+  {
+    const MeshType * cachedMesh = filter->GetOutput(output);
+    const MeshType * sizingFieldMesh = sizingFieldFilter->GetOutput(output);
+    ITK_TEST_EXPECT_EQUAL(cachedMesh->GetNumberOfPoints(), sizingFieldMesh->GetNumberOfPoints());
+    ITK_TEST_EXPECT_EQUAL(cachedMesh->GetNumberOfCells(), sizingFieldMesh->GetNumberOfCells());
+    bool samePoints = cachedMesh->GetNumberOfPoints() == sizingFieldMesh->GetNumberOfPoints();
+    for (itk::IdentifierType id = 0; samePoints && id < cachedMesh->GetNumberOfPoints(); id++)
+    {
+      samePoints = cachedMesh->GetPoint(id) == sizingFieldMesh->GetPoint(id);
+    }
+    ITK_TEST_EXPECT_TRUE(samePoints);
+  }
+  filter->CacheIntermediatesOff();
+  filter->ExportSizingFieldOff();
+
+  // Blend with the recursive Gaussian.
+  filter->SetSmoothing(itk::CleaverImageToMeshFilterEnums::Smoothing::Recursive);
+  ITK_TEST_SET_GET_VALUE(itk::CleaverImageToMeshFilterEnums::Smoothing::Recursive, filter->GetSmoothing());
+  ITK_TRY_EXPECT_NO_EXCEPTION(filter->Update());
+  std::cout << "Tetrahedra with recursive smoothing: " << filter->GetOutput(0)->GetNumberOfCells() << std::endl;
+  filter->SetSmoothing(itk::CleaverImageToMeshFilterEnums::Smoothing::Discrete);
+
+  // Keep the indicator functions near the interfaces only.
+  ITK_TEST_SET_GET_BOOLEAN(filter, UseSparseFields, true);
+  filter->SetNarrowBandWidth(8);
+  ITK_TEST_SET_GET_VALUE(8, filter->GetNarrowBandWidth());
+  // The mesher reads sparse fields through valueAt() only; their values are checked against dense
+  // fields in itkCleaverSparseScalarFieldTest.
+  ITK_TRY_EXPECT_NO_EXCEPTION(filter->Update());
+  std::cout << "Tetrahedra with sparse fields: " << filter->GetOutput(0)->GetNumberOfCells() << std::endl;
+  ITK_TEST_EXPECT_TRUE(filter->GetOutput(0)->GetNumberOfCells() > 0);
+  filter->UseSparseFieldsOff();
+
+  // A budget below a single label builds the labels one after the other on all the work units,
+  // with the same result as the concurrent labels.
+  ITK_TRY_EXPECT_NO_EXCEPTION(filter->Update());
+  const auto concurrentLabelsTetrahedra = filter->GetOutput(0)->GetNumberOfCells();
+  filter->SetIndicatorFunctionMemoryBudget(1);
+  ITK_TEST_SET_GET_VALUE(1, filter->GetIndicatorFunctionMemoryBudget());
+  ITK_TRY_EXPECT_NO_EXCEPTION(filter->Update());
+  ITK_TEST_EXPECT_EQUAL(filter->GetOutput(0)->GetNumberOfCells(), concurrentLabelsTetrahedra);
+  filter->SetIndicatorFunctionMemoryBudget(0);
+
+  // Mesh only the foreground bounding box; the meshed region must lie within the input.
+  ITK_TEST_SET_GET_BOOLEAN(filter, CropToForeground, true);
+  ITK_TRY_EXPECT_NO_EXCEPTION(filter->Update());
+  std::cout << "Meshed region: " << filter->GetMeshedRegion() << std::endl;
+  ITK_TEST_EXPECT_TRUE(filter->GetInput(0)->GetLargestPossibleRegion().IsInside(filter->GetMeshedRegion()));
+
+  // The meshes do not depend on the number of work units.
+  FilterType::Pointer serialFilter = FilterType::New();
+  for (unsigned int ii = 0; ii < filter->GetNumberOfIndexedInputs(); ii++)
+  {
+    serialFilter->SetInput(ii, filter->GetInput(ii));
+  }
+  serialFilter->SetAlpha(filter->GetAlpha());
+  serialFilter->SetCropToForeground(filter->GetCropToForeground());
+  serialFilter->SetNumberOfWorkUnits(1);
+  ITK_TRY_EXPECT_NO_EXCEPTION(serialFilter->Update());
+  for (unsigned int output = 0; output < 2; output++)
+  {
+    const MeshType * parallelMesh = filter->GetOutput(output);
+    const MeshType * serialMesh = serialFilter->GetOutput(output);
+    ITK_TEST_EXPECT_EQUAL(parallelMesh->GetNumberOfPoints(), serialMesh->GetNumberOfPoints());
+    ITK_TEST_EXPECT_EQUAL(parallelMesh->GetNumberOfCells(), serialMesh->GetNumberOfCells());
+    bool samePoints = parallelMesh->GetNumberOfPoints() == serialMesh->GetNumberOfPoints();
+    for (itk::IdentifierType id = 0; samePoints && id < parallelMesh->GetNumberOfPoints(); id++)
+    {
+      samePoints = parallelMesh->GetPoint(id) == serialMesh->GetPoint(id);
+    }
+    ITK_TEST_EXPECT_TRUE(samePoints);
+
+    bool sameCells = parallelMesh->GetNumberOfCells() == serialMesh->GetNumberOfCells();
+    for (itk::IdentifierType id = 0; sameCells && id < parallelMesh->GetNumberOfCells(); id++)
+    {
+      MeshType::CellAutoPointer parallelCell;
+      MeshType::CellAutoPointer serialCell;
+      parallelMesh->GetCell(id, parallelCell);
+      serialMesh->GetCell(id, serialCell);
+      sameCells = parallelCell->GetNumberOfPoints() == serialCell->GetNumberOfPoints() &&
+                  std::equal(parallelCell->PointIdsBegin(), parallelCell->PointIdsEnd(), serialCell->PointIdsBegin());
+
+      MeshType::CellPixelType parallelData{};
+      MeshType::CellPixelType serialData{};
+      sameCells = sameCells && parallelMesh->GetCellData(id, &parallelData) &&
+                  serialMesh->GetCellData(id, &serialData) && parallelData == serialData;
+    }
+    ITK_TEST_EXPECT_TRUE(sameCells);
+  }
+
+  // Compact form of the tetrahedral mesh only.
+  ITK_TEST_SET_GET_BOOLEAN(serialFilter, GenerateTriangleMesh, false);
+  ITK_TEST_SET_GET_BOOLEAN(serialFilter, GenerateCompactOutput, true);
+  ITK_TRY_EXPECT_NO_EXCEPTION(serialFilter->Update());
+  ITK_TEST_EXPECT_TRUE(serialFilter->GetCompactPoints(1) == nullptr);
+  ITK_TEST_EXPECT_EQUAL(serialFilter->GetOutput(0)->GetNumberOfCells(), 0);
+  const auto * compactPoints = serialFilter->GetCompactPoints(0);
+  const auto * compactConnectivity = serialFilter->GetCompactConnectivity(0);
+  const auto * compactLabels = serialFilter->GetCompactLabels(0);
+  ITK_TEST_EXPECT_EQUAL(compactPoints->Size(), 3 * filter->GetOutput(0)->GetNumberOfPoints());
+  ITK_TEST_EXPECT_EQUAL(compactConnectivity->Size(), 4 * filter->GetOutput(0)->GetNumberOfCells());
+  ITK_TEST_EXPECT_EQUAL(compactLabels->Size(), filter->GetOutput(0)->GetNumberOfCells());
+  ITK_TRY_EXPECT_EXCEPTION(serialFilter->GetCompactPoints(2));
+  ITK_TRY_EXPECT_EXCEPTION(serialFilter->GetCompactConnectivity(2));
+  ITK_TRY_EXPECT_EXCEPTION(serialFilter->GetCompactLabels(2));
+
+  // Only the region of interest is requested from the inputs.
+  FilterType::Pointer roiFilter = FilterType::New();
+  for (unsigned int ii = 0; ii < filter->GetNumberOfIndexedInputs(); ii++)
+  {
+    roiFilter->SetInput(ii, filter->GetInput(ii));
+  }
+  FilterType::InputImageRegionType regionOfInterest = filter->GetInput(0)->GetLargestPossibleRegion();
+  regionOfInterest.ShrinkByRadius(1);
+  roiFilter->SetRegionOfInterest(regionOfInterest);
+  ITK_TEST_SET_GET_VALUE(regionOfInterest, roiFilter->GetRegionOfInterest());
+  ITK_TRY_EXPECT_NO_EXCEPTION(roiFilter->UpdateOutputInformation());
+  ITK_TRY_EXPECT_NO_EXCEPTION(roiFilter->PropagateRequestedRegion(roiFilter->GetOutput(0)));
+  for (unsigned int ii = 0; ii < roiFilter->GetNumberOfIndexedInputs(); ii++)
+  {
+    ITK_TEST_EXPECT_EQUAL(roiFilter->GetInput(ii)->GetRequestedRegion(), regionOfInterest);
+  }
+
+  // A label image with integer pixels meshes like its float counterpart.
+  if (argc == 3)
+  {
+    using LabelImageType = itk::Image<unsigned char, Dimension>;
+    using CasterType = itk::CastImageFilter<ImageType, LabelImageType>;
+    auto caster = CasterType::New();
+    caster->SetInput(filter->GetInput(0));
+    ITK_TRY_EXPECT_NO_EXCEPTION(caster->Update());
+
+    using LabelFilterType = itk::CleaverImageToMeshFilter<LabelImageType, MeshType>;
+    auto labelFilter = LabelFilterType::New();
+    labelFilter->SetInput(caster->GetOutput());
+    ITK_TRY_EXPECT_NO_EXCEPTION(labelFilter->Update());
+    ITK_TEST_EXPECT_EQUAL(labelFilter->GetOutput(0)->GetNumberOfCells(), numberOfTetrahedra);
+  }
+
+  // Labels are material indices; a negative label is rejected instead of being left out of every material.
+  {
+    using SignedLabelImageType = itk::Image<short, Dimension>;
+    auto signedLabelImage = SignedLabelImageType::New();
+    SignedLabelImageType::SizeType size;
+    size.Fill(16);
+    signedLabelImage->SetRegions(size);
+    signedLabelImage->Allocate();
+    signedLabelImage->FillBuffer(1);
+    SignedLabelImageType::IndexType index;
+    index.Fill(8);
+    signedLabelImage->SetPixel(index, -1);
+
+    using SignedLabelFilterType = itk::CleaverImageToMeshFilter<SignedLabelImageType, MeshType>;
+    auto signedLabelFilter = SignedLabelFilterType::New();
+    signedLabelFilter->SetInput(signedLabelImage);
+    ITK_TRY_EXPECT_EXCEPTION(signedLabelFilter->Update());
+  }
+
   std::cout << "Test finished." << std::endl;
   return EXIT_SUCCESS;
 }
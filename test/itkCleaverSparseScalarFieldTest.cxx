@@ -0,0 +1,146 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCleaverImageScalarField.h"
+#include "itkCleaverSparseScalarField.h"
+
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+namespace
+{
+constexpr unsigned int Dimension = 3;
+using ImageType = itk::Image<float, Dimension>;
+
+// Signed distance, in voxels, to a sphere: positive inside, negative outside.
+ImageType::Pointer
+makeSphere(itk::SizeValueType size, double radius)
+{
+  auto                image = ImageType::New();
+  ImageType::SizeType imageSize;
+  imageSize.Fill(size);
+  image->SetRegions(imageSize);
+  image->Allocate();
+  const double                                  center = 0.5 * static_cast<double>(size);
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double distance = 0.0;
+    for (unsigned int d = 0; d < Dimension; d++)
+    {
+      const double offset = static_cast<double>(it.GetIndex()[d]) + 0.5 - center;
+      distance += offset * offset;
+    }
+    it.Set(static_cast<float>(radius - std::sqrt(distance)));
+  }
+  return image;
+}
+
+ImageType::Pointer
+makeConstant(itk::SizeValueType size, float value)
+{
+  auto                image = ImageType::New();
+  ImageType::SizeType imageSize;
+  imageSize.Fill(size);
+  image->SetRegions(imageSize);
+  image->Allocate();
+  image->FillBuffer(value);
+  return image;
+}
+
+std::string
+sparseError(const ImageType * image, unsigned int narrowBandWidth)
+{
+  itk::CleaverSparseScalarField<ImageType> field(image, image->GetLargestPossibleRegion(), narrowBandWidth, false);
+  return field.getError();
+}
+} // namespace
+
+int
+itkCleaverSparseScalarFieldTest(int, char *[])
+{
+  constexpr itk::SizeValueType size = 40;
+  constexpr unsigned int       narrowBandWidth = 4;
+
+  auto sphere = makeSphere(size, 10.0);
+
+  // The dense field wraps the buffer of its own image.
+  auto                                    denseImage = makeSphere(size, 10.0);
+  itk::CleaverImageScalarField<ImageType> dense(denseImage);
+  dense.Validate(false);
+
+  itk::CleaverSparseScalarField<ImageType> sparse(sphere, sphere->GetLargestPossibleRegion(), narrowBandWidth, false);
+  std::cout << "Dense blocks: " << sparse.GetNumberOfDenseBlocks() << ", memory: " << sparse.GetMemorySize()
+            << " bytes" << std::endl;
+  ITK_TEST_EXPECT_TRUE(sparse.GetNumberOfDenseBlocks() > 0);
+  ITK_TEST_EXPECT_TRUE(sparse.GetMemorySize() < denseImage->GetBufferedRegion().GetNumberOfPixels() * sizeof(float));
+
+  // The values are only reachable through valueAt(); there is no dense buffer to read.
+  ITK_TEST_EXPECT_TRUE(sparse.data() == nullptr);
+
+  // At the voxel centers, the values match within the band and the signs match everywhere.
+  bool sameValuesInBand = true;
+  bool sameSigns = true;
+  for (itk::SizeValueType k = 0; k < size; k++)
+  {
+    for (itk::SizeValueType j = 0; j < size; j++)
+    {
+      for (itk::SizeValueType i = 0; i < size; i++)
+      {
+        const double x = static_cast<double>(i) + 0.5;
+        const double y = static_cast<double>(j) + 0.5;
+        const double z = static_cast<double>(k) + 0.5;
+        const double denseValue = dense.valueAt(x, y, z);
+        const double sparseValue = sparse.valueAt(cleaver::vec3(x, y, z));
+        if (std::abs(denseValue) <= narrowBandWidth && std::abs(denseValue - sparseValue) > 1e-6)
+        {
+          sameValuesInBand = false;
+        }
+        if ((denseValue > 0.0) != (sparseValue > 0.0))
+        {
+          sameSigns = false;
+        }
+      }
+    }
+  }
+  ITK_TEST_EXPECT_TRUE(sameValuesInBand);
+  ITK_TEST_EXPECT_TRUE(sameSigns);
+
+  // Between voxel centers, within the band, the interpolation matches too.
+  const cleaver::vec3 between(20.25, 10.75, 20.5);
+  ITK_TEST_EXPECT_TRUE(std::abs(dense.valueAt(between) - sparse.valueAt(between)) < 1e-6);
+
+  // The same error flags as the dense field.
+  ITK_TEST_EXPECT_EQUAL(dense.getError(), std::string("none"));
+  ITK_TEST_EXPECT_EQUAL(sparseError(sphere, narrowBandWidth), std::string("none"));
+
+  ITK_TEST_EXPECT_EQUAL(sparseError(makeConstant(size, 1.0f), narrowBandWidth), std::string("maxmin"));
+  ITK_TEST_EXPECT_EQUAL(sparseError(makeConstant(size, -1.0f), narrowBandWidth), std::string("maxmin"));
+
+  ImageType::IndexType nanIndex;
+  nanIndex.Fill(20);
+  sphere->SetPixel(nanIndex, std::numeric_limits<float>::quiet_NaN());
+  ITK_TEST_EXPECT_EQUAL(sparseError(sphere, narrowBandWidth), std::string("nan"));
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
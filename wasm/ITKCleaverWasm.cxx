@@ -18,24 +18,71 @@
 #include "itkCleaverImageToMeshFilter.h"
 #include "itkPipeline.h"
 #include "itkInputImage.h"
+#include "itkOutputBinaryStream.h"
 #include "itkOutputMesh.h"
+#include "itkOutputTextStream.h"
 #include "itkSupportInputImageTypes.h"
 #include "itkMesh.h"
 
+#include <cstdint>
+
+// Write the elements of a compact output container as they are laid out in memory.
+template <typename TContainer>
+void
+writeCompactContainer(std::ostream & stream, const TContainer * container)
+{
+  const auto & elements = container->CastToSTLConstContainer();
+  stream.write(reinterpret_cast<const char *>(elements.data()),
+               static_cast<std::streamsize>(elements.size() * sizeof(typename TContainer::Element)));
+}
+
 template <typename TImage>
 int
 Mesher(itk::wasm::Pipeline & pipeline, std::vector<typename TImage::ConstPointer> & inputImages)
 {
   using ImageType = TImage;
 
-  using MeshType = itk::Mesh<typename ImageType::PixelType, 3>;
+  // The cell data of the triangles is the interface id, which a narrow input pixel type would wrap.
+  using MeshType = itk::Mesh<int32_t, 3>;
   using OutputMeshType = itk::wasm::OutputMesh<MeshType>;
   OutputMeshType outputTriangleMesh;
   pipeline.add_option("triangle", outputTriangleMesh, "Output triangle mesh")->type_name("OUTPUT_MESH");
 
+  itk::wasm::OutputTextStream stageStatistics;
+  pipeline.add_option("stage-statistics", stageStatistics, "Wall clock time, resident memory and cache reuse of each meshing stage")
+    ->type_name("OUTPUT_JSON");
+
+  itk::wasm::OutputBinaryStream compactPoints;
+  pipeline
+    .add_option("compact-points",
+                compactPoints,
+                "Interleaved x y z coordinates of the points of the compact triangle mesh, as little-endian float32")
+    ->type_name("OUTPUT_BINARY_STREAM");
+
+  itk::wasm::OutputBinaryStream compactConnectivity;
+  pipeline
+    .add_option("compact-connectivity",
+                compactConnectivity,
+                "Point ids of the triangles of the compact triangle mesh, three per triangle, as little-endian uint32")
+    ->type_name("OUTPUT_BINARY_STREAM");
+
+  itk::wasm::OutputBinaryStream compactLabels;
+  pipeline
+    .add_option("compact-labels",
+                compactLabels,
+                "Interface of each triangle of the compact triangle mesh, as little-endian int32")
+    ->type_name("OUTPUT_BINARY_STREAM");
+
   double sigma = 1.0;
   pipeline.add_option("-s,--sigma", sigma, "Blending function sigma for input(s) to remove alias artifacts.");
 
+  std::string smoothing = "discrete";
+  pipeline
+    .add_option("--smoothing",
+                smoothing,
+                "Gaussian used for the blending function: discrete, or recursive whose cost does not grow with sigma.")
+    ->check(CLI::IsMember({ "discrete", "recursive" }));
+
   double samplingRate = 1.0;
   pipeline.add_option("-r,--sampling-rate",
                       samplingRate,
@@ -59,6 +106,12 @@ Mesher(itk::wasm::Pipeline & pipeline, std::vector<typename TImage::ConstPointer
     padding,
     "Sizing field padding. Adds a volume buffer around the data. Useful when volumes intersect near the boundary.");
 
+  bool compact = false;
+  pipeline.add_flag("--compact",
+                    compact,
+                    "Write the triangle mesh to the compact flat arrays instead of the triangle mesh output, which is "
+                    "then empty.");
+
   ITK_WASM_PARSE(pipeline);
 
   using FilterType = itk::CleaverImageToMeshFilter<ImageType, MeshType>;
@@ -70,17 +123,39 @@ Mesher(itk::wasm::Pipeline & pipeline, std::vector<typename TImage::ConstPointer
   }
 
   filter->SetSigma(sigma);
+  filter->SetSmoothing(smoothing == "recursive" ? itk::CleaverImageToMeshFilterEnums::Smoothing::Recursive
+                                                : itk::CleaverImageToMeshFilterEnums::Smoothing::Discrete);
   filter->SetSamplingRate(samplingRate);
   filter->SetLipschitz(lipschitz);
   filter->SetFeatureScaling(featureScaling);
   filter->SetPadding(padding);
 
+  // Only the triangle mesh is returned.
+  filter->SetGenerateTetrahedralMesh(false);
+  filter->SetGenerateCompactOutput(compact);
+
   ITK_WASM_CATCH_EXCEPTION(pipeline, filter->Update());
 
   typename MeshType::ConstPointer triangleMesh = filter->GetOutput(1);
-  typename MeshType::ConstPointer mmesh = filter->GetOutput(0);
   outputTriangleMesh.Set(triangleMesh);
 
+  if (compact)
+  {
+    writeCompactContainer(compactPoints.Get(), filter->GetCompactPoints(1));
+    writeCompactContainer(compactConnectivity.Get(), filter->GetCompactConnectivity(1));
+    writeCompactContainer(compactLabels.Get(), filter->GetCompactLabels(1));
+  }
+
+  const auto & stages = filter->GetStageStatistics();
+  stageStatistics.Get() << "{\"stages\":[";
+  for (size_t ii = 0; ii < stages.size(); ii++)
+  {
+    stageStatistics.Get() << (ii ? "," : "") << "{\"name\":\"" << stages[ii].Name << "\",\"time\":" << stages[ii].Time
+                          << ",\"memory\":" << stages[ii].Memory << ",\"peakMemory\":" << stages[ii].PeakMemory
+                          << ",\"cached\":" << (stages[ii].Cached ? "true" : "false") << "}";
+  }
+  stageStatistics.Get() << "]}";
+
   return EXIT_SUCCESS;
 }
 
@@ -124,10 +199,10 @@ main(int argc, char * argv[])
                                argv);
 
   return itk::wasm::SupportInputImageTypes<PipelineFunctor,
-                                           // uint8_t,
+                                           uint8_t,
                                            // int8_t,
                                            uint16_t,
-                                           // int16_t,
+                                           int16_t,
                                            // float,
                                            // double
                                            float>::Dimensions<3U>("-i,--input", pipeline);
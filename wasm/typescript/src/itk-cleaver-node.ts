@@ -1,5 +1,7 @@
 import {
   Mesh,
+  JsonObject,
+  BinaryStream,
   Image,
   InterfaceTypes,
   PipelineOutput,
@@ -25,6 +27,10 @@ async function itkCleaverNode(
 
   const desiredOutputs: Array<PipelineOutput> = [
     { type: InterfaceTypes.Mesh },
+    { type: InterfaceTypes.JsonObject },
+    { type: InterfaceTypes.BinaryStream },
+    { type: InterfaceTypes.BinaryStream },
+    { type: InterfaceTypes.BinaryStream },
   ]
   const inputs: Array<PipelineInput> = [
   ]
@@ -33,6 +39,10 @@ async function itkCleaverNode(
   // Inputs
   // Outputs
   args.push('0')
+  args.push('1')
+  args.push('2')
+  args.push('3')
+  args.push('4')
   // Options
   args.push('--memory-io')
   if (typeof options.input !== "undefined") {
@@ -49,6 +59,9 @@ async function itkCleaverNode(
   if (typeof options.sigma !== "undefined") {
     args.push('--sigma', options.sigma.toString())
   }
+  if (typeof options.smoothing !== "undefined") {
+    args.push('--smoothing', options.smoothing.toString())
+  }
   if (typeof options.samplingRate !== "undefined") {
     args.push('--sampling-rate', options.samplingRate.toString())
   }
@@ -61,6 +74,9 @@ async function itkCleaverNode(
   if (typeof options.padding !== "undefined") {
     args.push('--padding', options.padding.toString())
   }
+  if (typeof options.compact !== "undefined") {
+    options.compact && args.push('--compact')
+  }
 
   const pipelinePath = path.join(path.dirname(import.meta.url.substring(7)), '..', 'pipelines', 'itk-cleaver')
 
@@ -75,6 +91,10 @@ async function itkCleaverNode(
 
   const result = {
     triangle: outputs[0].data as Mesh,
+    stageStatistics: outputs[1].data as JsonObject,
+    compactPoints: (outputs[2].data as BinaryStream).data,
+    compactConnectivity: (outputs[3].data as BinaryStream).data,
+    compactLabels: (outputs[4].data as BinaryStream).data,
   }
   return result
 }
@@ -7,6 +7,9 @@ interface ItkCleaverOptions {
   /** Blending function sigma for input(s) to remove alias artifacts. */
   sigma?: number
 
+  /** Gaussian used for the blending function: discrete, or recursive whose cost does not grow with sigma. */
+  smoothing?: string
+
   /** Sizing field sampling rate. The default sample rate will be the dimensions of the volume. Smaller sampling creates coarser meshes. */
   samplingRate?: number
 
@@ -19,6 +22,9 @@ interface ItkCleaverOptions {
   /** Sizing field padding. Adds a volume buffer around the data. Useful when volumes intersect near the boundary. */
   padding?: number
 
+  /** Write the triangle mesh to the compact flat arrays instead of the triangle mesh output, which is then empty. */
+  compact?: boolean
+
 }
 
 export default ItkCleaverOptions
@@ -1,4 +1,4 @@
-import { Mesh } from 'itk-wasm'
+import { Mesh, JsonObject } from 'itk-wasm'
 
 interface ItkCleaverResult {
   /** WebWorker used for computation */
@@ -7,6 +7,18 @@ interface ItkCleaverResult {
   /** Output triangle mesh */
   triangle: Mesh
 
+  /** Wall clock time, resident memory and cache reuse of each meshing stage */
+  stageStatistics: JsonObject
+
+  /** Interleaved x y z coordinates of the points of the compact triangle mesh, as little-endian float32 */
+  compactPoints: Uint8Array
+
+  /** Point ids of the triangles of the compact triangle mesh, three per triangle, as little-endian uint32 */
+  compactConnectivity: Uint8Array
+
+  /** Interface of each triangle of the compact triangle mesh, as little-endian int32 */
+  compactLabels: Uint8Array
+
 }
 
 export default ItkCleaverResult
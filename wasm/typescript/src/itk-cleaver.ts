@@ -1,5 +1,7 @@
 import {
   Mesh,
+  JsonObject,
+  BinaryStream,
   Image,
   InterfaceTypes,
   PipelineOutput,
@@ -29,6 +31,10 @@ async function itkCleaver(
 
   const desiredOutputs: Array<PipelineOutput> = [
     { type: InterfaceTypes.Mesh },
+    { type: InterfaceTypes.JsonObject },
+    { type: InterfaceTypes.BinaryStream },
+    { type: InterfaceTypes.BinaryStream },
+    { type: InterfaceTypes.BinaryStream },
   ]
   const inputs: Array<PipelineInput> = [
   ]
@@ -37,6 +43,10 @@ async function itkCleaver(
   // Inputs
   // Outputs
   args.push('0')
+  args.push('1')
+  args.push('2')
+  args.push('3')
+  args.push('4')
   // Options
   args.push('--memory-io')
   if (typeof options.input !== "undefined") {
@@ -53,6 +63,9 @@ async function itkCleaver(
   if (typeof options.sigma !== "undefined") {
     args.push('--sigma', options.sigma.toString())
   }
+  if (typeof options.smoothing !== "undefined") {
+    args.push('--smoothing', options.smoothing.toString())
+  }
   if (typeof options.samplingRate !== "undefined") {
     args.push('--sampling-rate', options.samplingRate.toString())
   }
@@ -65,6 +78,9 @@ async function itkCleaver(
   if (typeof options.padding !== "undefined") {
     args.push('--padding', options.padding.toString())
   }
+  if (typeof options.compact !== "undefined") {
+    options.compact && args.push('--compact')
+  }
 
   const pipelinePath = 'itk-cleaver'
 
@@ -81,6 +97,10 @@ async function itkCleaver(
   const result = {
     webWorker: usedWebWorker as Worker,
     triangle: outputs[0].data as Mesh,
+    stageStatistics: outputs[1].data as JsonObject,
+    compactPoints: (outputs[2].data as BinaryStream).data,
+    compactConnectivity: (outputs[3].data as BinaryStream).data,
+    compactLabels: (outputs[4].data as BinaryStream).data,
   }
   return result
 }